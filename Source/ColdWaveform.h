@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// A rendered waveform kept at 16 bits per sample, for the cache's cold
+// tier. Each channel is scaled to its own peak, so quiet grains keep
+// their resolution. Expanding back to floats is a single pass with no
+// decoding, far cheaper than reading and rendering the grain again.
+class ColdWaveform {
+public:
+  inline ColdWaveform(const juce::AudioBuffer<float> &buffer)
+      : numChannels(buffer.getNumChannels()),
+        numSamples(buffer.getNumSamples()), scales(size_t(numChannels)),
+        samples(size_t(numChannels) * size_t(numSamples)) {
+    for (int ch = 0; ch < numChannels; ch++) {
+      auto src = buffer.getReadPointer(ch);
+      auto peak = buffer.getMagnitude(ch, 0, numSamples);
+      auto toInt = peak > 0.f ? 32767.f / peak : 0.f;
+      scales[size_t(ch)] = peak / 32767.f;
+      auto dest = channel(ch);
+      for (int i = 0; i < numSamples; i++) {
+        dest[i] = juce::int16(std::lrint(src[i] * toInt));
+      }
+    }
+  }
+
+  // The buffer must already have the right size
+  inline void expand(juce::AudioBuffer<float> &buffer) const noexcept {
+    jassert(buffer.getNumChannels() == numChannels);
+    jassert(buffer.getNumSamples() == numSamples);
+    for (int ch = 0; ch < numChannels; ch++) {
+      auto src = channel(ch);
+      auto scale = scales[size_t(ch)];
+      auto dest = buffer.getWritePointer(ch);
+      for (int i = 0; i < numSamples; i++) {
+        dest[i] = float(src[i]) * scale;
+      }
+    }
+  }
+
+  inline juce::int64 sizeInBytes() const noexcept {
+    return sizeInBytes(numChannels, numSamples);
+  }
+
+  // What a cold copy of a buffer this size will take, before making one
+  static inline juce::int64 sizeInBytes(int numChannels,
+                                        int numSamples) noexcept {
+    return juce::int64(numChannels) * numSamples * sizeof(juce::int16) +
+           juce::int64(numChannels) * sizeof(float);
+  }
+
+  const int numChannels, numSamples;
+
+private:
+  std::vector<float> scales;
+  std::vector<juce::int16> samples;
+
+  inline juce::int16 *channel(int ch) noexcept {
+    return samples.data() + size_t(ch) * size_t(numSamples);
+  }
+  inline const juce::int16 *channel(int ch) const noexcept {
+    return samples.data() + size_t(ch) * size_t(numSamples);
+  }
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ColdWaveform)
+};
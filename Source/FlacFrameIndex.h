@@ -0,0 +1,275 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Byte offsets of every frame in a fixed-blocksize FLAC stream, so decoding
+// can begin directly at the frame holding a particular sample instead of
+// bisecting the compressed stream. Built by scanning frame headers, and
+// cached in a sidecar file next to the archive.
+class FlacFrameIndex {
+public:
+  // Identifies the archive and stream a saved index was built from
+  struct Fingerprint {
+    static constexpr int magic = 0x58465652; // "RVFX"
+    static constexpr int version = 1;
+    juce::int64 fileSize{0}, modificationTime{0}, streamOffset{0};
+
+    inline Fingerprint() {}
+    inline Fingerprint(const juce::File &file, juce::int64 streamOffset)
+        : fileSize(file.getSize()),
+          modificationTime(file.getLastModificationTime().toMilliseconds()),
+          streamOffset(streamOffset) {}
+
+    inline bool operator==(const Fingerprint &o) const noexcept {
+      return fileSize == o.fileSize && modificationTime == o.modificationTime &&
+             streamOffset == o.streamOffset;
+    }
+
+    inline bool read(juce::InputStream &in) {
+      if (in.readInt() != magic || in.readInt() != version) {
+        return false;
+      }
+      fileSize = in.readInt64();
+      modificationTime = in.readInt64();
+      streamOffset = in.readInt64();
+      return true;
+    }
+
+    inline void write(juce::OutputStream &out) const {
+      out.writeInt(magic);
+      out.writeInt(version);
+      out.writeInt64(fileSize);
+      out.writeInt64(modificationTime);
+      out.writeInt64(streamOffset);
+    }
+  };
+
+  int blockSize{0}, channels{0}, bitsPerSample{0};
+  juce::int64 totalSamples{0};
+  juce::Array<juce::int64> frameOffsets;
+
+  inline bool isValid() const noexcept {
+    return blockSize > 0 && !frameOffsets.isEmpty();
+  }
+
+  inline int numFrames() const noexcept { return frameOffsets.size(); }
+
+  inline int frameForSample(juce::int64 sample) const noexcept {
+    return int(juce::jlimit<juce::int64>(0, numFrames() - 1,
+                                         sample / blockSize));
+  }
+
+  inline juce::int64 firstSampleOfFrame(int frame) const noexcept {
+    return juce::int64(frame) * blockSize;
+  }
+
+  inline bool build(const juce::uint8 *data, juce::int64 length) {
+    frameOffsets.clearQuick();
+    auto pos = readMetadata(data, length);
+    if (pos < 0) {
+      return false;
+    }
+    // With a known stream length every frame must be accounted for.
+    // Without one, we accept frames until the headers stop matching.
+    bool knownLength = totalSamples > 0;
+    juce::int64 expectedFrames =
+        knownLength ? (totalSamples + blockSize - 1) / blockSize : -1;
+    while (!knownLength || numFrames() < expectedFrames) {
+      pos = findFrameHeader(data, length, pos, numFrames(), expectedFrames);
+      if (pos < 0) {
+        break;
+      }
+      frameOffsets.add(pos);
+      pos++;
+    }
+    if (!knownLength) {
+      totalSamples = firstSampleOfFrame(numFrames());
+    }
+    if (numFrames() < 1 || (knownLength && numFrames() != expectedFrames)) {
+      frameOffsets.clear();
+      return false;
+    }
+    return true;
+  }
+
+  inline bool read(juce::InputStream &in, const Fingerprint &expected) {
+    Fingerprint actual;
+    if (!actual.read(in) || !(actual == expected)) {
+      return false;
+    }
+    blockSize = in.readInt();
+    channels = in.readInt();
+    bitsPerSample = in.readInt();
+    totalSamples = in.readInt64();
+    auto count = in.readInt();
+    auto expectedBytes = juce::int64(count) * sizeof(juce::int64);
+    if (blockSize < 1 || count < 1 ||
+        in.getNumBytesRemaining() != expectedBytes) {
+      return false;
+    }
+    frameOffsets.clearQuick();
+    frameOffsets.ensureStorageAllocated(count);
+    for (int i = 0; i < count; i++) {
+      frameOffsets.add(in.readInt64());
+    }
+    return true;
+  }
+
+  inline void write(juce::OutputStream &out, const Fingerprint &fp) const {
+    fp.write(out);
+    out.writeInt(blockSize);
+    out.writeInt(channels);
+    out.writeInt(bitsPerSample);
+    out.writeInt64(totalSamples);
+    out.writeInt(numFrames());
+    for (auto offset : frameOffsets) {
+      out.writeInt64(offset);
+    }
+  }
+
+private:
+  static constexpr int maxHeaderSize = 16;
+
+  inline juce::int64 readMetadata(const juce::uint8 *data,
+                                  juce::int64 length) {
+    if (length < 4 || memcmp(data, "fLaC", 4) != 0) {
+      return -1;
+    }
+    juce::int64 pos = 4;
+    bool isLast = false;
+    blockSize = 0;
+    while (!isLast) {
+      if (pos + 4 > length) {
+        return -1;
+      }
+      isLast = (data[pos] & 0x80) != 0;
+      int type = data[pos] & 0x7f;
+      int size = (data[pos + 1] << 16) | (data[pos + 2] << 8) | data[pos + 3];
+      pos += 4;
+      if (pos + size > length) {
+        return -1;
+      }
+      if (type == 0 && size >= 34) {
+        // STREAMINFO. Only fixed blocksize streams can be indexed this way.
+        auto b = data + pos;
+        int minBlockSize = (b[0] << 8) | b[1];
+        int maxBlockSize = (b[2] << 8) | b[3];
+        if (minBlockSize != maxBlockSize) {
+          return -1;
+        }
+        blockSize = minBlockSize;
+        channels = 1 + ((b[12] >> 1) & 7);
+        bitsPerSample = 1 + (((b[12] & 1) << 4) | (b[13] >> 4));
+        totalSamples = (juce::int64(b[13] & 0x0f) << 32) |
+                       (juce::int64(b[14]) << 24) | (b[15] << 16) |
+                       (b[16] << 8) | b[17];
+      }
+      pos += size;
+    }
+    return blockSize > 0 ? pos : -1;
+  }
+
+  inline juce::int64 findFrameHeader(const juce::uint8 *data,
+                                     juce::int64 length, juce::int64 pos,
+                                     int frameNumber,
+                                     juce::int64 expectedFrames) const {
+    while (pos + 4 <= length) {
+      auto next = static_cast<const juce::uint8 *>(
+          memchr(data + pos, 0xff, size_t(length - pos)));
+      if (next == nullptr) {
+        break;
+      }
+      pos = next - data;
+      auto available = length - pos;
+      int headerSize;
+      if (available >= maxHeaderSize) {
+        headerSize = frameHeaderSize(next, frameNumber, expectedFrames);
+      } else {
+        // Near the end of the stream, parse from a zero-padded copy
+        juce::uint8 padded[maxHeaderSize] = {};
+        memcpy(padded, next, size_t(available));
+        headerSize = frameHeaderSize(padded, frameNumber, expectedFrames);
+      }
+      if (headerSize > 0 && headerSize <= available) {
+        return pos;
+      }
+      pos++;
+    }
+    return -1;
+  }
+
+  // Returns the size of a matching frame header including its CRC,
+  // or zero if this isn't the header for the frame we expected.
+  inline int frameHeaderSize(const juce::uint8 *p, int frameNumber,
+                             juce::int64 expectedFrames) const {
+    // Sync code with the fixed blocksize strategy bit
+    if (p[0] != 0xff || p[1] != 0xf8) {
+      return 0;
+    }
+    int blockSizeCode = p[2] >> 4, sampleRateCode = p[2] & 0xf;
+    int channelCode = p[3] >> 4, sampleSizeCode = (p[3] >> 1) & 7;
+    if (blockSizeCode == 0 || sampleRateCode == 0xf || channelCode > 10 ||
+        sampleSizeCode == 3 || (p[3] & 1) != 0) {
+      return 0;
+    }
+
+    // Frame number, in a UTF-8 style variable length encoding
+    int pos = 4, leadingOnes = 0;
+    while (leadingOnes < 8 && (p[pos] & (0x80 >> leadingOnes))) {
+      leadingOnes++;
+    }
+    if (leadingOnes == 1 || leadingOnes > 6) {
+      return 0;
+    }
+    juce::uint32 number = p[pos++] & (0x7f >> leadingOnes);
+    for (int i = 1; i < leadingOnes; i++) {
+      if ((p[pos] & 0xc0) != 0x80) {
+        return 0;
+      }
+      number = (number << 6) | (p[pos++] & 0x3f);
+    }
+    if (number != juce::uint32(frameNumber)) {
+      return 0;
+    }
+
+    // All frames but the last must use the stream's block size
+    int frameBlockSize;
+    if (blockSizeCode == 1) {
+      frameBlockSize = 192;
+    } else if (blockSizeCode <= 5) {
+      frameBlockSize = 576 << (blockSizeCode - 2);
+    } else if (blockSizeCode == 6) {
+      frameBlockSize = 1 + p[pos];
+      pos += 1;
+    } else if (blockSizeCode == 7) {
+      frameBlockSize = 1 + ((p[pos] << 8) | p[pos + 1]);
+      pos += 2;
+    } else {
+      frameBlockSize = 256 << (blockSizeCode - 8);
+    }
+    bool isLastFrame = frameNumber + 1 == expectedFrames;
+    if (frameBlockSize != blockSize &&
+        !(isLastFrame && frameBlockSize < blockSize)) {
+      return 0;
+    }
+
+    if (sampleRateCode == 12) {
+      pos += 1;
+    } else if (sampleRateCode == 13 || sampleRateCode == 14) {
+      pos += 2;
+    }
+    return crc8(p, pos) == p[pos] ? pos + 1 : 0;
+  }
+
+  static inline juce::uint8 crc8(const juce::uint8 *p, int size) noexcept {
+    juce::uint8 crc = 0;
+    while (size--) {
+      crc ^= *(p++);
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x80) ? juce::uint8((crc << 1) ^ 0x07)
+                           : juce::uint8(crc << 1);
+      }
+    }
+    return crc;
+  }
+};
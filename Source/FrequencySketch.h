@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Approximate count of how often each hash has been seen recently, as a
+// count-min sketch of small saturating counters. Every so often all
+// counts are halved, so old popularity fades. Fixed size, and never
+// allocates after construction.
+class FrequencySketch {
+public:
+  static constexpr int depth = 4;
+  static constexpr int maxCount = 15;
+
+  inline FrequencySketch(int widthLog2 = 12)
+      : mask((size_t(1) << widthLog2) - 1),
+        counters(size_t(depth) << widthLog2),
+        sampleSize(10 << widthLog2) {}
+
+  inline void increment(std::size_t hash) noexcept {
+    bool added = false;
+    for (int row = 0; row < depth; row++) {
+      auto &counter = counters[slot(hash, row)];
+      if (counter < maxCount) {
+        counter++;
+        added = true;
+      }
+    }
+    if (added && ++additions >= sampleSize) {
+      halve();
+    }
+  }
+
+  inline int estimate(std::size_t hash) const noexcept {
+    int result = maxCount;
+    for (int row = 0; row < depth; row++) {
+      result = std::min<int>(result, counters[slot(hash, row)]);
+    }
+    return result;
+  }
+
+private:
+  const std::size_t mask;
+  std::vector<juce::uint8> counters;
+  const int sampleSize;
+  int additions{0};
+
+  inline std::size_t slot(std::size_t hash, int row) const noexcept {
+    // A different odd multiplier per row spreads one hash over every row
+    static constexpr juce::uint64 seeds[depth] = {
+        0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull,
+        0xd6e8feb86659fd93ull};
+    auto mixed = juce::uint64(hash) * seeds[row];
+    return size_t(row) * (mask + 1) + (size_t(mixed >> 32) & mask);
+  }
+
+  inline void halve() noexcept {
+    for (auto &counter : counters) {
+      counter >>= 1;
+    }
+    additions /= 2;
+  }
+};
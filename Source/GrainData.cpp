@@ -1,8 +1,62 @@
 #include "GrainData.h"
 #include "FLAC/stream_decoder.h"
+#include "GrainDsp.h"
 #include "ZipReader64.h"
 #include <deque>
 
+#if JUCE_LINUX || JUCE_MAC
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#elif JUCE_WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <winioctl.h>
+#endif
+
+// Loaders, tables and grain indexes shared by every GrainData in the
+// process, so plugin instances don't each start a thread per CPU or keep
+// their own copy of an index. Indexes are shared by path and modification
+// time, and kept a while after their last user lets go, so reloading the
+// same file finds its waveform cache still warm.
+class GrainData::Shared {
+public:
+  Shared();
+  ~Shared();
+
+  // Finds or loads the index for a file. Sets 'isNew' if this call loaded
+  // it, in which case the caller finishes loading sources and frames.
+  GrainIndex::Ptr getIndex(const juce::File &, bool &isNew);
+  void cleanup(int inactivityThreshold);
+  // Opens an index's PCM sidecar on a background thread, if it's wanted
+  void openPcmSidecar(const GrainIndex::Ptr &);
+
+  SampleBufferPool::Ptr samplePool;
+  ResamplerCache resamplerCache;
+  // Instances with any loader jobs queued
+  std::atomic<int> busyClients{0};
+  juce::Atomic<int> waveformThreadSequence{0};
+  std::atomic<int> queuedWaveformJobs{0};
+  juce::OwnedArray<WaveformLoaderThread> waveformLoaderThreads;
+
+private:
+  struct RegisteredIndex {
+    GrainIndex::Ptr index;
+    juce::Time modified;
+    int cleanupCounter{0};
+  };
+
+  std::mutex indexMutex;
+  std::unordered_map<juce::String, RegisteredIndex> indexes;
+  int cleanupCounter{0};
+  juce::ThreadPool backgroundThreads{1};
+  std::unique_ptr<CacheCleanupJob> cacheCleanupJob;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Shared)
+};
+
 class GrainData::CacheCleanupJob : private juce::ThreadPoolJob,
                                    private juce::Timer {
   static constexpr int intervalMilliseconds = 750;
@@ -11,8 +65,8 @@ class GrainData::CacheCleanupJob : private juce::ThreadPoolJob,
       inactivitySeconds / (1000 / intervalMilliseconds);
 
 public:
-  CacheCleanupJob(juce::ThreadPool &pool, GrainData &grainData)
-      : ThreadPoolJob("cache-cleanup"), pool(pool), grainData(grainData) {
+  CacheCleanupJob(juce::ThreadPool &pool, Shared &shared)
+      : ThreadPoolJob("cache-cleanup"), pool(pool), shared(shared) {
     startTimer(intervalMilliseconds);
   }
 
@@ -20,7 +74,7 @@ public:
 
 private:
   juce::ThreadPool &pool;
-  GrainData &grainData;
+  Shared &shared;
   bool isPending{false};
 
   void timerCallback() override {
@@ -31,10 +85,7 @@ private:
   }
 
   JobStatus runJob() override {
-    auto index = grainData.getIndex();
-    if (index != nullptr) {
-      index->cache.cleanup(inactivityThreshold);
-    }
+    shared.cleanup(inactivityThreshold);
     isPending = false;
     return JobStatus::jobHasFinished;
   }
@@ -43,8 +94,12 @@ private:
 class GrainData::IndexLoaderJob : private juce::ThreadPoolJob,
                                   private juce::Value::Listener {
 public:
-  IndexLoaderJob(juce::ThreadPool &pool)
-      : ThreadPoolJob("grain-index"), pool(pool) {
+  IndexLoaderJob(juce::ThreadPool &pool, Shared &shared,
+                 const std::atomic<juce::int64> &cacheBudgetBytes,
+                 const std::atomic<bool> &pcmSidecarEnabled)
+      : ThreadPoolJob("grain-index"), pool(pool), shared(shared),
+        cacheBudgetBytes(cacheBudgetBytes),
+        pcmSidecarEnabled(pcmSidecarEnabled) {
     srcValue.addListener(this);
   }
 
@@ -88,7 +143,8 @@ private:
       }
       latestLoadingAttempt = srcToLoad;
     }
-    GrainIndex::Ptr newIndex = new GrainIndex(srcToLoad);
+    bool isNew = false;
+    auto newIndex = shared.getIndex(srcToLoad, isNew);
     juce::String newStatus = newIndex->status.wasOk()
                                  ? newIndex->describeToString()
                                  : newIndex->status.getErrorMessage();
@@ -96,17 +152,32 @@ private:
       std::lock_guard<std::mutex> guard(indexMutex);
       indexPtr = newIndex;
     }
+    newIndex->cache.setBudget(cacheBudgetBytes);
     {
       juce::ScopedLock guard(valuesRecursiveMutex);
       statusValue.setValue(newStatus);
     }
-    // Asynchronously load the sources, after the index itself is active
-    newIndex->sources.load(srcToLoad);
+    // Asynchronously load the sources and frame table, after the index
+    // itself is active. A shared index is loaded by whoever created it.
+    if (isNew) {
+      newIndex->sources.load(srcToLoad);
+      newIndex->frames.load(*newIndex);
+    }
+    // The PCM sidecar is opened separately, if any of its users want it
+    if (newIndex->status.wasOk()) {
+      if (pcmSidecarEnabled) {
+        newIndex->frames.requestPcm();
+      }
+      shared.openPcmSidecar(newIndex);
+    }
     // Check again in case a change occurred while we were loading
     return JobStatus::jobNeedsRunningAgain;
   }
 
   juce::ThreadPool &pool;
+  Shared &shared;
+  const std::atomic<juce::int64> &cacheBudgetBytes;
+  const std::atomic<bool> &pcmSidecarEnabled;
 
   std::mutex indexMutex;
   GrainIndex::Ptr indexPtr;
@@ -124,60 +195,84 @@ public:
   struct Job {
     GrainIndex::Ptr index;
     GrainWaveform::Key key;
+    // Placeholder from the cache, which we fill in and publish
+    GrainWaveform::Ptr wave;
+    // When a voice needs this waveform, in getMillisecondCounterHiRes() time
+    double deadline;
+    // The instance that asked for it
+    Client::Ptr client;
   };
 
-  WaveformLoaderThread() : Thread("grain-waveform") {}
+  WaveformLoaderThread(Shared &shared)
+      : Thread("grain-waveform"), shared(shared) {}
 
-  ~WaveformLoaderThread() override {
-    if (decoder) {
-      FLAC__stream_decoder_delete(decoder);
-    }
-  }
+  ~WaveformLoaderThread() override { releaseDecoder(); }
 
   void addJob(const Job &j) {
+    // Backlogged jobs are dropped only once the whole pool is saturated,
+    // since idle threads will steal from any queue that's behind. Then
+    // each instance with jobs queued is entitled to an equal share of the
+    // backlog, and those over their share lose jobs first, so a busy
+    // instance can't crowd out the rest.
     static constexpr int maxJobBacklog = 20;
-    struct Expiration {
-      GrainIndex::Ptr index;
-      std::vector<GrainWaveform::Key> keysToRemove;
-    };
-    std::unordered_map<GrainIndex *, Expiration> expirationsByIndex;
+    const int maxPoolBacklog =
+        maxJobBacklog * shared.waveformLoaderThreads.size();
+    Expirations expirations;
     {
-      // The work queue is actually set up as LIFO so we
-      // prioritize new jobs even if there is a backlog.
-      // Jobs to expire are saved for processing without this lock held.
+      // The work queue is kept in order of earliest deadline first. Among
+      // equal deadlines, new jobs go first. The jobs with the latest
+      // deadlines are dropped from a backlog.
       std::lock_guard<std::mutex> guard(workMutex);
-      workQueue.push_front(j);
-      while (workQueue.size() > maxJobBacklog) {
-        const auto &job = workQueue.back();
-        auto &expiration = expirationsByIndex[job.index.get()];
-        if (expiration.index == nullptr) {
-          expiration.index = job.index;
-        }
-        jassert(expiration.index.get() == job.index.get());
-        expiration.keysToRemove.push_back(job.key);
-        workQueue.pop_back();
+      auto position = std::find_if(
+          workQueue.begin(), workQueue.end(),
+          [&](const Job &job) { return job.deadline >= j.deadline; });
+      workQueue.insert(position, j);
+      queued(j);
+      while (workQueue.size() > 1 &&
+             shared.queuedWaveformJobs > maxPoolBacklog) {
+        auto share = maxPoolBacklog / std::max(1, shared.busyClients.load());
+        auto over = std::find_if(
+            workQueue.rbegin(), workQueue.rend(),
+            [&](const Job &job) { return job.client->queuedJobs > share; });
+        auto victim = over != workQueue.rend() ? std::prev(over.base())
+                                               : std::prev(workQueue.end());
+        expirations.add(*victim);
+        dequeued(*victim);
+        workQueue.erase(victim);
       }
     }
-    // Expire excessively backlogged loading jobs in batches by index
-    for (auto &item : expirationsByIndex) {
-      auto &expiration = item.second;
-      expiration.index->cache.expire(expiration.keysToRemove);
-    }
+    expirations.expireAll();
     notify();
+    if (!isIdle) {
+      wakeIdleSibling();
+    }
   }
 
   void run() override {
+    std::vector<Job> batch;
+    Expirations expirations;
     while (!threadShouldExit()) {
-      workMutex.lock();
-      if (workQueue.empty()) {
-        workMutex.unlock();
-        wait(-1);
-      } else {
-        Job job = workQueue.front();
-        workQueue.pop_front();
-        workMutex.unlock();
-        runJob(job);
+      {
+        std::lock_guard<std::mutex> guard(workMutex);
+        takeBatch(batch, expirations);
       }
+      if (batch.empty()) {
+        // Mark ourselves idle before looking for work to steal, so any job
+        // queued after this point will wake us.
+        isIdle = true;
+        if (!stealBatch(batch, expirations)) {
+          expirations.expireAll();
+          releaseUnusedIndex();
+          wait(-1);
+          isIdle = false;
+          continue;
+        }
+        isIdle = false;
+      }
+      expirations.expireAll();
+      readAheadQueuedJobs();
+      runBatch(batch);
+      batch.clear();
     }
   }
 
@@ -186,14 +281,81 @@ public:
     return workQueue.size();
   }
 
+  // Wakes an idle loader, so it can let go of an index that its last
+  // instance has since dropped
+  void wakeIfIdle() {
+    if (isIdle) {
+      notify();
+    }
+  }
+
 private:
+  // Cursor over the sound stream of one GrainIndex. Reads come from the
+  // index's shared memory mapping when it has one, and otherwise from a
+  // private file stream owned by this thread.
+  class SoundStream {
+  public:
+    void attach(GrainIndex &newIndex) {
+      index = newIndex;
+      position = 0;
+      if (index->soundFileData == nullptr) {
+        file = std::make_unique<juce::FileInputStream>(index->file);
+      } else {
+        file = nullptr;
+      }
+    }
+
+    void detach() {
+      index = nullptr;
+      file = nullptr;
+    }
+
+    inline GrainIndex *getIndex() const noexcept { return index.get(); }
+
+    inline juce::int64 getLength() const noexcept {
+      return index->soundFileBytes.getLength();
+    }
+
+    inline juce::int64 getPosition() const noexcept { return position; }
+
+    inline void setPosition(juce::int64 newPosition) noexcept {
+      position = juce::jlimit<juce::int64>(0, getLength(), newPosition);
+    }
+
+    size_t read(void *dest, size_t bytes) {
+      auto available = size_t(getLength() - position);
+      bytes = std::min(bytes, available);
+      if (index->soundFileData != nullptr) {
+        memcpy(dest, index->soundFileData + position, bytes);
+      } else {
+        file->setPosition(index->soundFileBytes.getStart() + position);
+        bytes = std::max(0, file->read(dest, int(bytes)));
+      }
+      position += bytes;
+      return bytes;
+    }
+
+  private:
+    GrainIndex::Ptr index;
+    std::unique_ptr<juce::FileInputStream> file;
+    juce::int64 position{0};
+  };
+
+  Shared &shared;
   std::mutex workMutex;
   std::deque<Job> workQueue;
+  std::atomic<bool> isIdle{false};
+  std::vector<std::pair<GrainIndex::Ptr, unsigned>> readAheadGrains;
 
-  std::unique_ptr<juce::FileInputStream> stream;
-  juce::Range<juce::int64> byteRange;
+  SoundStream sound;
   FLAC__StreamDecoder *decoder{nullptr};
-  juce::Interpolators::WindowedSinc interpolator;
+  int decoderNextFrame{-1};
+  juce::AudioBuffer<float> decoderScratch;
+  juce::MemoryBlock pcmScratch;
+  std::vector<const float *> sourcePtrs;
+  std::vector<float> resamplerTaps;
+  static constexpr int windowBlockSize = 1024;
+  float windowBlock[windowBlockSize];
 
   struct {
     juce::AudioBuffer<float> audio;
@@ -201,114 +363,588 @@ private:
     int progress, size;
   } buffer;
 
-  void runJob(const Job &job) {
-    if (!job.index) {
+  void readAheadQueuedJobs() {
+    // Ask the OS to start paging in the sound stream for the next few jobs
+    // in our queue, so their disk reads overlap with the current batch.
+    static constexpr int maxReadAheadJobs = 8;
+    {
+      std::lock_guard<std::mutex> guard(workMutex);
+      for (auto &job : workQueue) {
+        if (readAheadGrains.size() >= maxReadAheadJobs) {
+          break;
+        }
+        if (job.index != nullptr) {
+          readAheadGrains.push_back({job.index, job.key.grain});
+        }
+      }
+    }
+    for (auto &item : readAheadGrains) {
+      item.first->readAhead(rawGrainRange(*item.first, item.second));
+    }
+    readAheadGrains.clear();
+  }
+
+  // Jobs dropped from a queue, to be cancelled in their caches in batches
+  // by index once no queue lock is held
+  class Expirations {
+  public:
+    void add(const Job &job) {
+      auto &item = byIndex[job.index.get()];
+      if (item.index == nullptr) {
+        item.index = job.index;
+      }
+      jassert(item.index.get() == job.index.get());
+      item.wavesToCancel.push_back(job.wave);
+    }
+
+    void expireAll() {
+      for (auto &item : byIndex) {
+        item.second.index->cache.cancel(item.second.wavesToCancel);
+      }
+      byIndex.clear();
+    }
+
+  private:
+    struct Item {
+      GrainIndex::Ptr index;
+      std::vector<GrainWaveform::Ptr> wavesToCancel;
+    };
+    std::unordered_map<GrainIndex *, Item> byIndex;
+  };
+
+  bool stealBatch(std::vector<Job> &batch, Expirations &expirations) {
+    // Visit the other loaders in turn, starting with our neighbour
+    auto &threads = shared.waveformLoaderThreads;
+    auto self = threads.indexOf(this);
+    for (int i = 1; i < threads.size(); i++) {
+      auto victim = threads[(self + i) % threads.size()];
+      std::lock_guard<std::mutex> guard(victim->workMutex);
+      if (victim->takeBatch(batch, expirations)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void wakeIdleSibling() {
+    for (auto t : shared.waveformLoaderThreads) {
+      if (t != this && t->isIdle) {
+        t->notify();
+        return;
+      }
+    }
+  }
+
+  inline void queued(const Job &job) noexcept {
+    shared.queuedWaveformJobs += 1;
+    if (job.client->queuedJobs++ == 0) {
+      shared.busyClients += 1;
+    }
+  }
+
+  inline void dequeued(const Job &job) noexcept {
+    shared.queuedWaveformJobs -= 1;
+    if (--job.client->queuedJobs == 0) {
+      shared.busyClients -= 1;
+    }
+  }
+
+  // Call with workMutex held. Owners and thieves alike take the job with
+  // the earliest deadline, after dropping any whose deadline has passed.
+  bool takeBatch(std::vector<Job> &batch, Expirations &expirations) {
+    // A voice that hasn't started playing will wait for a late grain, so
+    // jobs get a grace period before we consider them useless.
+    static constexpr double lateJobGraceMilliseconds = 100.;
+    static constexpr int maxBatchSamples = 1 << 20;
+    auto expired =
+        juce::Time::getMillisecondCounterHiRes() - lateJobGraceMilliseconds;
+    while (!workQueue.empty() && workQueue.front().deadline < expired) {
+      expirations.add(workQueue.front());
+      dequeued(workQueue.front());
+      workQueue.pop_front();
+    }
+    if (workQueue.empty()) {
+      return false;
+    }
+
+    // Starting with that job, take every queued job on the same index
+    // whose raw source audio overlaps the batch so far. These can all be
+    // served by one pass through the decoder.
+    batch.push_back(workQueue.front());
+    dequeued(workQueue.front());
+    workQueue.pop_front();
+    auto index = batch.front().index.get();
+    if (index == nullptr) {
+      return true;
+    }
+    auto span = rawGrainRange(*index, batch.front().key.grain);
+    bool added = true;
+    while (added) {
+      added = false;
+      for (auto job = workQueue.begin(); job != workQueue.end();) {
+        if (job->index.get() == index) {
+          auto jobSpan = rawGrainRange(*index, job->key.grain);
+          auto merged = span.getUnionWith(jobSpan);
+          if (span.intersects(jobSpan) &&
+              merged.getLength() <= maxBatchSamples) {
+            span = merged;
+            batch.push_back(*job);
+            dequeued(*job);
+            job = workQueue.erase(job);
+            added = true;
+            continue;
+          }
+        }
+        ++job;
+      }
+    }
+    return true;
+  }
+
+  void runBatch(const std::vector<Job> &batch) {
+    if (!batch.front().index) {
       return;
     }
-    GrainIndex &index = *job.index;
+    GrainIndex &index = *batch.front().index;
     jassert(index.isValid());
 
-    if (!index.cache.contains(job.key)) {
-      // Abandon loading items that have already been deleted from the cache
-      return;
+    // Abandon loading items that have already been deleted from the cache
+    std::vector<const Job *> jobs;
+    for (auto &job : batch) {
+      jassert(job.index.get() == &index);
+      jassert(job.key.grain < index.numGrains());
+      if (job.wave->getState() == GrainWaveform::State::pending) {
+        jobs.push_back(&job);
+      }
     }
 
-    // (Re)open the input file as necessary
-    if (!stream || stream->getFile() != index.file) {
-      stream = std::make_unique<juce::FileInputStream>(index.file);
-      byteRange = index.soundFileBytes;
-      if (decoder) {
-        FLAC__stream_decoder_delete(decoder);
-        decoder = nullptr;
+    // Source audio for each grain comes from disk only if it isn't cached
+    std::unordered_map<unsigned, DecodedAudio::Ptr> raws;
+    std::vector<juce::Range<juce::int64>> spansToDecode;
+    for (auto job : jobs) {
+      auto grain = job->key.grain;
+      if (raws.find(grain) == raws.end()) {
+        auto raw = index.rawGrains.lookup(grain);
+        if (raw == nullptr) {
+          spansToDecode.push_back(rawGrainRange(index, grain));
+        }
+        raws[grain] = raw;
       }
     }
 
+    // Decode each run of overlapping spans once, and slice it into grains
+    std::sort(spansToDecode.begin(), spansToDecode.end(),
+              [](const juce::Range<juce::int64> &a,
+                 const juce::Range<juce::int64> &b) {
+                return a.getStart() < b.getStart();
+              });
+    for (size_t first = 0; first < spansToDecode.size();) {
+      auto run = spansToDecode[first];
+      auto last = first + 1;
+      while (last < spansToDecode.size() &&
+             run.intersects(spansToDecode[last])) {
+        run = run.getUnionWith(spansToDecode[last++]);
+      }
+      auto decoded = decodeRange(index, run);
+      if (decoded != nullptr) {
+        for (auto &item : raws) {
+          if (item.second == nullptr) {
+            auto span = rawGrainRange(index, item.first);
+            if (run.contains(span)) {
+              item.second = sliceRange(*decoded, span);
+              index.rawGrains.store(item.first, *item.second);
+            }
+          }
+        }
+      }
+      first = last;
+    }
+
+    // Fill in placeholders, and cancel any we couldn't load so voices
+    // don't wait on them
+    std::vector<GrainWaveform::Ptr> failed;
+    for (auto job : jobs) {
+      auto &raw = raws[job->key.grain];
+      if (raw != nullptr && renderWaveform(index, *raw, *job->wave)) {
+        index.cache.store(*job->wave);
+      } else {
+        failed.push_back(job->wave);
+      }
+    }
+    if (!failed.empty()) {
+      index.cache.cancel(failed);
+    }
+  }
+
+  DecodedAudio::Ptr decodeRange(GrainIndex &index,
+                                const juce::Range<juce::int64> &range) {
+    if (index.soundFormat != GrainIndex::SoundFormat::flac) {
+      return convertRange(index, range);
+    }
+
+    // Attach to the index's sound stream, restarting the decoder
+    if (sound.getIndex() != &index) {
+      releaseDecoder();
+      sound.attach(index);
+    }
+
     // (Re)init the FLAC decoder as necessary
     if (decoder == nullptr) {
       decoder = FLAC__stream_decoder_new();
       jassert(decoder != nullptr);
       if (decoder == nullptr) {
-        return;
+        return nullptr;
       }
-      stream->setPosition(byteRange.getStart());
+      sound.setPosition(0);
       auto status = FLAC__stream_decoder_init_stream(
           decoder, flacRead, flacSeek, flacTell, flacLength, flacEOF, flacWrite,
           flacMetadata, flacError, this);
       jassert(status == FLAC__STREAM_DECODER_INIT_STATUS_OK);
+      if (!FLAC__stream_decoder_process_until_end_of_metadata(decoder)) {
+        jassertfalse;
+        releaseDecoder();
+        return nullptr;
+      }
     }
 
-    jassert(job.key.grain < index.numGrains());
-    juce::int64 grainX = index.grainX[job.key.grain];
-    auto speedRatio = job.key.speedRatio;
-    auto range = job.key.window.range();
-
-    auto resamplerLatency = interpolator.getBaseLatency() / speedRatio;
-    juce::Range<int> resampledRange(
-        std::floor(range.getStart() * speedRatio - resamplerLatency),
-        std::ceil(range.getEnd() * speedRatio));
-
-    buffer.firstSample = resampledRange.getStart() + grainX;
-    buffer.size = resampledRange.getLength();
+    buffer.firstSample = range.getStart();
+    buffer.size = int(range.getLength());
     buffer.progress = 0;
 
     // Read in FLAC frames containing the audio we want
-    if (!FLAC__stream_decoder_seek_absolute(
-            decoder, std::max<juce::int64>(0, buffer.firstSample))) {
+    if (!readFrames(index)) {
       jassertfalse;
-      return;
-    };
-    while (buffer.progress < buffer.size) {
-      if (!FLAC__stream_decoder_process_single(decoder)) {
-        jassertfalse;
-        return;
-      }
+      return nullptr;
     }
     jassert(buffer.progress == buffer.size);
     jassert(buffer.audio.getNumSamples() == buffer.size);
+    return new DecodedAudio(buffer.firstSample, std::move(buffer.audio));
+  }
 
-    auto numChannels = buffer.audio.getNumChannels();
-    GrainWaveform::Ptr wave =
-        new GrainWaveform(job.key, numChannels, range.getLength());
-    auto readPtrs = buffer.audio.getArrayOfReadPointers();
-    auto writePtrs = wave->buffer.getArrayOfWritePointers();
+  DecodedAudio::Ptr convertRange(GrainIndex &index,
+                                 const juce::Range<juce::int64> &range) {
+    // Uncompressed streams are converted straight from the mapping, or read
+    // into scratch space when it isn't mapped. Samples outside the stream
+    // are silent.
+    auto channels = index.soundChannels;
+    auto frameBytes = index.soundBytesPerFrame();
+    DecodedAudio::Ptr result =
+        new DecodedAudio(range.getStart(), channels, int(range.getLength()));
+    result->audio.clear();
+    auto available = range.getIntersectionWith({0, index.numSamples});
+    if (available.isEmpty()) {
+      return result;
+    }
+    auto offset = int(available.getStart() - range.getStart());
+    auto numSamples = int(available.getLength());
 
-    // Resample audio from temp buffer into GrainWaveform buffer
-    for (auto ch = 0; ch < numChannels; ch++) {
-      interpolator.reset();
-      interpolator.process(speedRatio, readPtrs[ch], writePtrs[ch],
-                           range.getLength());
+    const juce::uint8 *data;
+    if (index.soundFileData != nullptr) {
+      data = index.soundFileData + available.getStart() * frameBytes;
+    } else {
+      if (sound.getIndex() != &index) {
+        releaseDecoder();
+        sound.attach(index);
+      }
+      auto bytes = size_t(numSamples) * size_t(frameBytes);
+      pcmScratch.ensureSize(bytes);
+      sound.setPosition(available.getStart() * frameBytes);
+      if (sound.read(pcmScratch.getData(), bytes) != bytes) {
+        jassertfalse;
+        return nullptr;
+      }
+      data = static_cast<const juce::uint8 *>(pcmScratch.getData());
     }
 
-    // Apply each of the pre-normalization IIR filter stages on each channel
-    juce::SingleThreadedIIRFilter iir;
-    for (const auto &stage : job.key.filters) {
-      iir.setCoefficients(stage);
-      for (int ch = 0; ch < numChannels; ch++) {
-        iir.reset();
-        iir.processSamples(writePtrs[ch], range.getLength());
+    for (int ch = 0; ch < channels; ch++) {
+      auto output = result->audio.getWritePointer(ch, offset);
+      if (index.soundFormat == GrainIndex::SoundFormat::s16le) {
+        for (int i = 0; i < numSamples; i++) {
+          output[i] = juce::int16(juce::ByteOrder::littleEndianShort(
+              data + (size_t(i) * channels + ch) * 2));
+        }
+      } else {
+        for (int i = 0; i < numSamples; i++) {
+          auto bits = juce::ByteOrder::littleEndianInt(
+              data + (size_t(i) * channels + ch) * 4);
+          memcpy(&output[i], &bits, sizeof(float));
+        }
       }
     }
+    return result;
+  }
 
-    // Apply windowing and RMS normalization in-place in GrainWaveform buffer
+  static DecodedAudio::Ptr sliceRange(DecodedAudio &decoded,
+                                      const juce::Range<juce::int64> &range) {
+    if (decoded.range() == range) {
+      return decoded;
+    }
+    jassert(decoded.range().contains(range));
+    auto channels = decoded.audio.getNumChannels();
+    auto length = int(range.getLength());
+    auto offset = int(range.getStart() - decoded.firstSample);
+    DecodedAudio::Ptr slice =
+        new DecodedAudio(range.getStart(), channels, length);
+    for (int ch = 0; ch < channels; ch++) {
+      slice->audio.copyFrom(ch, 0, decoded.audio, ch, offset, length);
+    }
+    return slice;
+  }
+
+  juce::Range<juce::int64> rawGrainRange(const GrainIndex &index,
+                                         unsigned grain) const {
+    // Windows reach at most maxGrainWidth seconds to either side of the
+    // grain at the source sample rate, plus some room for the resampler.
+    auto halfWidth = juce::int64(std::ceil(index.maxGrainWidth *
+                                           index.sampleRates[grain])) +
+                     rawGrainMargin();
+    juce::int64 grainX = index.grainX[grain];
+    return juce::Range<juce::int64>(grainX - halfWidth, grainX + halfWidth);
+  }
+
+  static int rawGrainMargin() {
+    // Enough for the resampler's filter at speed ratios up to 8. Faster
+    // speeds read silence past the edges of the raw grain.
+    static const int margin = ResamplerFilterBank::halfTapsForRatio(8.f) + 1;
+    return margin;
+  }
+
+  // Renders into a placeholder's buffer, which no voice reads until the
+  // cache marks it ready. Returns false if the audio can't be held.
+  bool renderWaveform(const GrainIndex &index, const DecodedAudio &raw,
+                      GrainWaveform &wave) {
+    auto &key = wave.key;
+    juce::int64 grainX = index.grainX[key.grain];
+    auto speedRatio = key.speedRatio;
+    auto range = key.window.range();
+
+    // Window positions map to source positions relative to the grain
+    auto resampler = shared.resamplerCache.get(
+        ResamplerFilterBank::cutoffStepForRatio(speedRatio));
+    double firstPosition = range.getStart() * double(speedRatio);
+    auto sourceRange =
+        resampler->footprint(speedRatio, firstPosition, range.getLength()) +
+        grainX;
+
+    // Normally the resampler reads straight from the raw grain. If we need
+    // samples from outside it, read from a zero-padded copy instead.
+    const juce::AudioBuffer<float> *source = &raw.audio;
+    int sourceOffset = int(sourceRange.getStart() - raw.firstSample);
+    if (!raw.range().contains(sourceRange)) {
+      buffer.firstSample = sourceRange.getStart();
+      buffer.size = int(sourceRange.getLength());
+      buffer.progress = 0;
+      storeSamples(raw.firstSample, raw.audio);
+      fillRemainingWithSilence(raw.audio.getNumChannels());
+      source = &buffer.audio;
+      sourceOffset = 0;
+    }
+
+    auto numChannels = source->getNumChannels();
+    if (!wave.allocate(*shared.samplePool, numChannels, range.getLength())) {
+      return false;
+    }
+    auto writePtrs = wave.buffer.getArrayOfWritePointers();
+
+    // Resample audio from the source into GrainWaveform buffer
+    sourcePtrs.resize(size_t(numChannels));
+    for (auto ch = 0; ch < numChannels; ch++) {
+      sourcePtrs[size_t(ch)] = source->getReadPointer(ch, sourceOffset);
+    }
+    resamplerTaps.resize(size_t(resampler->numTaps));
+    resampler->process(speedRatio, sourcePtrs.data(), numChannels,
+                       firstPosition - double(sourceRange.getStart() - grainX),
+                       writePtrs, range.getLength(), resamplerTaps.data());
+
+    // Apply the pre-normalization IIR filter stages, all in one pass
+    juce::IIRCoefficients stages[GrainWaveform::Filters::maxStages];
+    auto numStages = key.filters.makeCoefficients(stages);
+    GrainDsp::applyBiquadCascade(writePtrs, numChannels, range.getLength(),
+                                 stages, numStages);
+
+    // Apply windowing and RMS normalization in-place in GrainWaveform buffer.
+    // The window is sampled a block at a time and shared by all channels.
     double accum = 0.;
-    for (int i = 0; i < range.getLength(); i++) {
-      auto window = job.key.window.evaluate(range.getStart() + i);
+    for (int done = 0; done < range.getLength(); done += windowBlockSize) {
+      auto num = std::min(windowBlockSize, range.getLength() - done);
+      key.window.evaluate(range.getStart() + done, windowBlock, num);
       for (int ch = 0; ch < numChannels; ch++) {
-        accum += double(juce::square<float>(writePtrs[ch][i] *= window));
+        accum += GrainDsp::applyWindow(writePtrs[ch] + done, windowBlock, num);
       }
     }
     auto rms = std::sqrt(accum / double(numChannels * range.getLength()));
-    wave->buffer.applyGain(1.0 / rms);
+    for (int ch = 0; ch < numChannels; ch++) {
+      juce::FloatVectorOperations::multiply(writePtrs[ch], float(1.0 / rms),
+                                            range.getLength());
+    }
+    return true;
+  }
 
-    index.cache.store(*wave);
+  bool readFrames(GrainIndex &index) {
+    auto frames = index.frames.get();
+    auto channels = int(FLAC__stream_decoder_get_channels(decoder));
+    if (frames == nullptr) {
+      // No frame table (yet), libFLAC can search for the first sample
+      // and we decode straight through from there.
+      decoderNextFrame = -1;
+      auto firstSample = std::max<juce::int64>(0, buffer.firstSample);
+      if (firstSample < index.numSamples &&
+          !FLAC__stream_decoder_seek_absolute(decoder, firstSample)) {
+        return false;
+      }
+      while (buffer.progress < buffer.size) {
+        if (buffer.firstSample + buffer.progress >= index.numSamples) {
+          fillRemainingWithSilence(channels);
+        } else if (!FLAC__stream_decoder_process_single(decoder)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    auto pcm = index.frames.getPcm();
+    while (buffer.progress < buffer.size) {
+      auto progress = buffer.progress;
+      if (buffer.firstSample + progress >= frames->totalSamples) {
+        // Raw grains near the end of the stream are padded with silence
+        fillRemainingWithSilence(channels);
+        break;
+      }
+      auto frameNumber = frames->frameForSample(buffer.firstSample + progress);
+
+      // Frames recently decoded by any loader are shared in the cache,
+      // and frames decoded by any process may be in the PCM sidecar
+      auto cached = index.frameCache.lookup(frameNumber);
+      if (cached == nullptr && pcm != nullptr) {
+        DecodedAudio::Ptr frame =
+            new DecodedAudio(frames->firstSampleOfFrame(frameNumber), 0, 0);
+        if (pcm->readFrame(frameNumber, frame->audio)) {
+          index.frameCache.store(frameNumber, *frame);
+          cached = frame;
+        }
+      }
+      if (cached != nullptr) {
+        storeSamples(cached->firstSample, cached->audio);
+      } else {
+        // Start decoding at the frame holding this sample, unless the
+        // decoder is already there. Samples before the one we want are
+        // skipped when the frame is stored.
+        if (frameNumber != decoderNextFrame) {
+          sound.setPosition(frames->frameOffsets[frameNumber]);
+          if (!FLAC__stream_decoder_flush(decoder)) {
+            return false;
+          }
+        }
+        if (!FLAC__stream_decoder_process_single(decoder) ||
+            decoderNextFrame != frameNumber + 1) {
+          decoderNextFrame = -1;
+          return false;
+        }
+      }
+      if (buffer.progress == progress) {
+        // Ran past the end of the stream
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void storeDecodedFrame(juce::int64 sampleNumber, int channels,
+                         int numSamples, const FLAC__int32 *const samples[]) {
+    // Decode into a new cacheable frame if we have a table to number frames
+    // by, otherwise decode into scratch space.
+    auto frames = sound.getIndex()->frames.get();
+    auto frameNumber = -1;
+    DecodedAudio::Ptr frame;
+    juce::AudioBuffer<float> *audio = &decoderScratch;
+    if (frames != nullptr && sampleNumber % frames->blockSize == 0) {
+      frameNumber = int(sampleNumber / frames->blockSize);
+      frame = new DecodedAudio(sampleNumber, channels, numSamples);
+      audio = &frame->audio;
+      decoderNextFrame = frameNumber + 1;
+    } else {
+      decoderScratch.setSize(channels, numSamples, false, false, true);
+      decoderNextFrame = -1;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+      juce::FloatVectorOperations::convertFixedToFloat(
+          audio->getWritePointer(ch), samples[ch], 1.f, numSamples);
+    }
+    if (frame != nullptr) {
+      auto pcm = sound.getIndex()->frames.getPcm();
+      if (pcm != nullptr) {
+        pcm->writeFrame(frameNumber, frame->audio);
+      }
+      sound.getIndex()->frameCache.store(frameNumber, *frame);
+    }
+    storeSamples(sampleNumber, *audio);
+  }
+
+  void storeSamples(juce::int64 sampleNumber,
+                    const juce::AudioBuffer<float> &audio) {
+    auto channels = audio.getNumChannels();
+    buffer.audio.setSize(channels, buffer.size);
+
+    auto progress = buffer.progress;
+    auto remaining = buffer.size - progress;
+    juce::int64 wantSampleNumber = buffer.firstSample + progress;
+
+    auto samplesToZeroFill = std::max<int>(
+        0, std::min<juce::int64>(sampleNumber - wantSampleNumber, remaining));
+    auto samplesToSkip = std::max<int>(
+        0, std::min<juce::int64>(wantSampleNumber - sampleNumber,
+                                 remaining - samplesToZeroFill));
+    auto samplesToStore = std::max<int>(
+        0, std::min<int>(audio.getNumSamples() - samplesToSkip,
+                         remaining - samplesToZeroFill - samplesToSkip));
+
+    auto input = audio.getArrayOfReadPointers();
+    auto output = buffer.audio.getArrayOfWritePointers();
+    for (auto ch = 0; ch < channels; ch++) {
+      juce::FloatVectorOperations::clear(output[ch] + progress,
+                                         samplesToZeroFill);
+      juce::FloatVectorOperations::copy(
+          output[ch] + progress + samplesToZeroFill,
+          input[ch] + samplesToSkip, samplesToStore);
+    }
+    buffer.progress = progress + samplesToZeroFill + samplesToStore;
+    jassert(buffer.progress <= buffer.size);
+  }
+
+  void fillRemainingWithSilence(int channels) {
+    buffer.audio.setSize(channels, buffer.size, true);
+    for (int ch = 0; ch < channels; ch++) {
+      juce::FloatVectorOperations::clear(
+          buffer.audio.getWritePointer(ch, buffer.progress),
+          buffer.size - buffer.progress);
+    }
+    buffer.progress = buffer.size;
+  }
+
+  void releaseDecoder() {
+    if (decoder) {
+      FLAC__stream_decoder_delete(decoder);
+      decoder = nullptr;
+    }
+    decoderNextFrame = -1;
+  }
+
+  void releaseUnusedIndex() {
+    // While idle, don't keep an index mapped only for our sake. The shared
+    // registry may hold another reference, which it will drop in time. Its
+    // cleanup wakes us periodically, since an instance may let go of the
+    // index long after we went to sleep.
+    auto index = sound.getIndex();
+    if (index != nullptr && index->getReferenceCount() <= 2) {
+      releaseDecoder();
+      sound.detach();
+    }
   }
 
   static FLAC__StreamDecoderSeekStatus
   flacSeek(const FLAC__StreamDecoder *, FLAC__uint64 absolute_byte_offset,
            void *client_data) {
     auto self = static_cast<WaveformLoaderThread *>(client_data);
-    self->stream->setPosition(absolute_byte_offset +
-                              self->byteRange.getStart());
+    self->sound.setPosition(absolute_byte_offset);
     return FLAC__STREAM_DECODER_SEEK_STATUS_OK;
   }
 
@@ -316,8 +952,7 @@ private:
   flacTell(const FLAC__StreamDecoder *, FLAC__uint64 *absolute_byte_offset,
            void *client_data) {
     auto self = static_cast<WaveformLoaderThread *>(client_data);
-    *absolute_byte_offset =
-        self->stream->getPosition() - self->byteRange.getStart();
+    *absolute_byte_offset = self->sound.getPosition();
     return FLAC__STREAM_DECODER_TELL_STATUS_OK;
   }
 
@@ -325,13 +960,13 @@ private:
                                                     FLAC__uint64 *stream_length,
                                                     void *client_data) {
     auto self = static_cast<WaveformLoaderThread *>(client_data);
-    *stream_length = self->byteRange.getLength();
+    *stream_length = self->sound.getLength();
     return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
   }
 
   static FLAC__bool flacEOF(const FLAC__StreamDecoder *, void *client_data) {
     auto self = static_cast<WaveformLoaderThread *>(client_data);
-    return self->stream->getPosition() >= self->byteRange.getEnd();
+    return self->sound.getPosition() >= self->sound.getLength();
   }
 
   static void flacMetadata(const FLAC__StreamDecoder *,
@@ -347,7 +982,7 @@ private:
                                                 size_t *bytes,
                                                 void *client_data) {
     auto self = static_cast<WaveformLoaderThread *>(client_data);
-    *bytes = self->stream->read(buffer, *bytes);
+    *bytes = self->sound.read(buffer, *bytes);
     return (*bytes == 0) ? FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM
                          : FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
   }
@@ -355,49 +990,223 @@ private:
   static FLAC__StreamDecoderWriteStatus
   flacWrite(const FLAC__StreamDecoder *, const FLAC__Frame *frame,
             const FLAC__int32 *const buffer[], void *client_data) {
-
-    juce::int64 sampleNumber = frame->header.number.sample_number;
     if (frame->header.number_type != FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER) {
       return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
     }
-
     auto self = static_cast<WaveformLoaderThread *>(client_data);
-    self->buffer.audio.setSize(frame->header.channels, self->buffer.size);
+    self->storeDecodedFrame(frame->header.number.sample_number,
+                            frame->header.channels, frame->header.blocksize,
+                            buffer);
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+  }
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformLoaderThread)
+};
 
-    auto progress = self->buffer.progress;
-    auto remaining = self->buffer.size - progress;
-    juce::int64 wantSampleNumber = self->buffer.firstSample + progress;
+// Does the allocating and freeing on behalf of the audio thread. It keeps
+// a pool of spare placeholders topped up, caches the placeholders voices
+// have requested and passes them on to loaders, and releases references
+// the audio thread has retired. The audio thread never waits for this,
+// so we poll rather than being notified. Polling is quick while the audio
+// thread is busy, and backs off while the rings stay empty.
+class GrainData::AudioHelperThread : public juce::Thread {
+public:
+  static constexpr int minPollMilliseconds = 2, maxPollMilliseconds = 20;
 
-    auto samplesToZeroFill = std::max<int>(
-        0, std::min<int>(sampleNumber - wantSampleNumber, remaining));
-    auto samplesToSkip =
-        std::max<int>(0, std::min<int>(wantSampleNumber - sampleNumber,
-                                       remaining - samplesToZeroFill));
-    auto samplesToStore = std::max<int>(
-        0, std::min<int>(frame->header.blocksize - samplesToSkip,
-                         remaining - samplesToZeroFill - samplesToSkip));
+  AudioHelperThread(GrainData &grainData)
+      : Thread("grain-audio-helper"), grainData(grainData) {
+    refillPlaceholders();
+  }
 
-    auto output = self->buffer.audio.getArrayOfWritePointers();
-    for (auto ch = 0; ch < frame->header.channels; ch++) {
-      for (auto i = 0; i < samplesToZeroFill; i++) {
-        output[ch][progress + i] = 0.f;
+  void run() override {
+    int pollMilliseconds = minPollMilliseconds;
+    while (!threadShouldExit()) {
+      bool busy = false;
+      Request request;
+      while (grainData.requests.pop(request)) {
+        dispatch(request);
+        request = {};
+        busy = true;
       }
-      for (auto i = 0; i < samplesToStore; i++) {
-        output[ch][progress + samplesToZeroFill + i] =
-            buffer[ch][samplesToSkip + i];
+      GrainWaveform::Ptr wave;
+      while (grainData.retired.pop(wave)) {
+        wave = nullptr;
+        busy = true;
       }
+      refillPlaceholders();
+      pollMilliseconds =
+          busy ? minPollMilliseconds
+               : std::min(maxPollMilliseconds, pollMilliseconds * 2);
+      wait(pollMilliseconds);
     }
-    self->buffer.progress = progress + samplesToZeroFill + samplesToStore;
-    jassert(self->buffer.progress <= self->buffer.size);
-    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
   }
 
-  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformLoaderThread)
+private:
+  GrainData &grainData;
+
+  void refillPlaceholders() {
+    while (grainData.placeholders.getFreeSpace() > 0) {
+      GrainWaveform::Ptr wave = new GrainWaveform(GrainWaveform::Key{});
+      grainData.placeholders.push(std::move(wave));
+    }
+  }
+
+  void dispatch(const Request &request) {
+    auto &index = *request.index;
+    auto cached = index.cache.lookupOrInsert(*request.wave);
+    if (cached != request.wave) {
+      // Another request for the same key beat us here. The voice will
+      // find that one once it sees its own placeholder was cancelled.
+      request.wave->cancel();
+      return;
+    }
+    auto &shared = *grainData.shared;
+    if (index.cache.promote(*request.wave, *shared.samplePool)) {
+      return;
+    }
+
+    // Dispatch it to a rotating worker thread. Idle workers will steal it
+    // if that thread is busy.
+    auto &threads = shared.waveformLoaderThreads;
+    int seq = (shared.waveformThreadSequence += 1) % threads.size();
+    threads[seq]->addJob(WaveformLoaderThread::Job{
+        .index = request.index,
+        .key = request.wave->key,
+        .wave = request.wave,
+        .deadline = request.deadline,
+        .client = grainData.client,
+    });
+  }
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioHelperThread)
 };
 
+GrainData::Shared::Shared()
+    : samplePool(new SampleBufferPool()),
+      cacheCleanupJob(
+          std::make_unique<CacheCleanupJob>(backgroundThreads, *this)) {
+  for (auto i = juce::SystemStats::getNumCpus(); i; --i) {
+    waveformLoaderThreads.add(new WaveformLoaderThread(*this));
+  }
+  for (auto t : waveformLoaderThreads) {
+    t->startThread();
+  }
+}
+
+GrainData::Shared::~Shared() {
+  for (auto *t : waveformLoaderThreads) {
+    t->signalThreadShouldExit();
+    t->notify();
+  }
+  for (auto *t : waveformLoaderThreads) {
+    t->waitForThreadToExit(-1);
+  }
+}
+
+GrainIndex::Ptr GrainData::Shared::getIndex(const juce::File &file,
+                                            bool &isNew) {
+  auto path = file.getFullPathName();
+  auto modified = file.getLastModificationTime();
+  {
+    std::lock_guard<std::mutex> guard(indexMutex);
+    auto item = indexes.find(path);
+    if (item != indexes.end() && item->second.modified == modified) {
+      item->second.cleanupCounter = cleanupCounter;
+      isNew = false;
+      return item->second.index;
+    }
+  }
+
+  // Load without the lock held. If another instance got there first, use
+  // its index instead. Failed loads aren't shared, so they can be retried.
+  GrainIndex::Ptr index = new GrainIndex(file);
+  isNew = true;
+  if (!index->status.wasOk()) {
+    return index;
+  }
+  // Let index deletion happen without the lock held
+  GrainIndex::Ptr indexToRelease;
+  std::lock_guard<std::mutex> guard(indexMutex);
+  auto &slot = indexes[path];
+  if (slot.index != nullptr && slot.modified == modified) {
+    indexToRelease = index;
+    index = slot.index;
+    isNew = false;
+  } else {
+    indexToRelease = slot.index;
+    slot.index = index;
+    slot.modified = modified;
+  }
+  slot.cleanupCounter = cleanupCounter;
+  return index;
+}
+
+void GrainData::Shared::openPcmSidecar(const GrainIndex::Ptr &index) {
+  if (index->frames.isPcmWanted()) {
+    backgroundThreads.addJob([index] { index->frames.openPcm(*index); });
+  }
+}
+
+void GrainData::Shared::cleanup(int inactivityThreshold) {
+  // Clean each index's cache, and let index deletion happen, without the
+  // registry lock held
+  std::vector<GrainIndex::Ptr> indexesInUse, indexesToRelease;
+  {
+    std::lock_guard<std::mutex> guard(indexMutex);
+    int counter = cleanupCounter++;
+    for (auto item = indexes.begin(); item != indexes.end();) {
+      auto &slot = item->second;
+      if (slot.index->getReferenceCount() > 1) {
+        slot.cleanupCounter = counter;
+      }
+      if (counter - slot.cleanupCounter >= inactivityThreshold) {
+        indexesToRelease.push_back(slot.index);
+        item = indexes.erase(item);
+      } else {
+        indexesInUse.push_back(slot.index);
+        ++item;
+      }
+    }
+  }
+  for (auto &index : indexesInUse) {
+    index->cache.cleanup(inactivityThreshold);
+  }
+  // Idle loaders keep the last index they used, which would otherwise
+  // count as in use here forever. Let go of ours first, so they can tell
+  // whether anyone else still holds it.
+  indexesInUse.clear();
+  for (auto t : waveformLoaderThreads) {
+    t->wakeIfIdle();
+  }
+  resamplerCache.cleanup(inactivityThreshold);
+}
+
+GrainWaveform::GrainWaveform(const Key &key)
+    : key(key), state(State::pending) {}
 GrainWaveform::GrainWaveform(const Key &key, int channels, int samples)
-    : key(key), buffer(channels, samples) {}
-GrainWaveform::~GrainWaveform() {}
+    : key(key), buffer(channels, samples), state(State::ready) {}
+GrainWaveform::~GrainWaveform() {
+  if (storage != nullptr) {
+    pool->release(storage, storageCapacity);
+  }
+}
+
+bool GrainWaveform::allocate(SampleBufferPool &samplePool, int channels,
+                             int samples) {
+  jassert(storage == nullptr && getState() == State::pending);
+  if (channels < 1 || channels > GrainIndex::maxSoundChannels) {
+    jassertfalse;
+    return false;
+  }
+  pool = samplePool;
+  storage = pool->allocate(channels * samples, storageCapacity);
+  float *channelPtrs[GrainIndex::maxSoundChannels];
+  for (int ch = 0; ch < channels; ch++) {
+    channelPtrs[ch] = storage + ch * samples;
+  }
+  buffer.setDataToReferTo(channelPtrs, channels, samples);
+  return true;
+}
 
 GrainIndex::GrainIndex(const juce::File &file) : file(file), status(load()) {}
 GrainIndex::~GrainIndex() {}
@@ -413,104 +1222,546 @@ void GrainWaveformCache::removeListener(Listener *listener) {
 }
 
 juce::int64 GrainWaveformCache::sizeInBytes() {
-  std::lock_guard<std::mutex> guard(cacheMutex);
-  return totalBytes;
+  juce::int64 total = 0;
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    total += shard.totalBytes;
+  }
+  return total;
 }
 
-void GrainWaveformCache::cleanup(int inactivityThreshold) {
-  // Let waveform deletion happen without the cache lock held
-  std::vector<GrainWaveform::Ptr> wavesToRelease;
-  std::vector<GrainWaveform::Key> keysToRemove;
-  {
-    std::lock_guard<std::mutex> guard(cacheMutex);
-
-    int sizeOfWavesToRelease = 0;
-    int counter = cleanupCounter;
-    cleanupCounter = counter + 1;
-
-    for (auto &item : map) {
-      int age = counter - item.second.cleanupCounter;
-      if (age >= inactivityThreshold) {
-        auto &wave = item.second.wave;
-        auto waveRefs = wave == nullptr ? 0 : wave->getReferenceCount();
-        if (waveRefs <= 1) {
-          keysToRemove.push_back(item.first);
-          if (wave != nullptr) {
-            wavesToRelease.push_back(wave);
-            sizeOfWavesToRelease += wave->sizeInBytes();
-          }
-        }
-      }
+void GrainWaveformCache::setBudget(juce::int64 bytes) {
+  std::vector<GrainWaveform::Ptr> wavesToRelease, demotions;
+  std::vector<GrainWaveform::Key> keysRemoved;
+  for (auto &shard : shards) {
+    {
+      std::lock_guard<std::mutex> guard(shard.mutex);
+      shard.budgetBytes = bytes / numShards;
+      shard.evictLocked(keysRemoved, wavesToRelease, demotions);
     }
-    totalBytes -= sizeOfWavesToRelease;
+    shard.finishDemotions(demotions, wavesToRelease);
   }
-  expire(keysToRemove);
+  notifyExpired(keysRemoved);
 }
 
-void GrainWaveformCache::expire(const std::vector<GrainWaveform::Key> &keys) {
-  {
-    std::lock_guard<std::mutex> guard(cacheMutex);
-    for (auto &key : keys) {
-      map.erase(key);
-    }
-  }
-  {
-    std::lock_guard<std::mutex> guard(listenerMutex);
-    for (auto &key : keys) {
-      listeners.call([key](Listener &l) { l.grainWaveformExpired(key); });
+void GrainWaveformCache::cleanup(int inactivityThreshold) {
+  int cutoff = cleanupCounter++ - inactivityThreshold;
+
+  // One batch at a time, so lookups carry on between batches
+  for (auto &shard : shards) {
+    bool more = true;
+    while (more) {
+      std::vector<GrainWaveform::Ptr> wavesToRelease;
+      std::vector<GrainWaveform::Key> keysRemoved;
+      {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        more = shard.cleanupBatchLocked(cutoff, keysRemoved, wavesToRelease);
+      }
+      notifyExpired(keysRemoved);
     }
   }
 }
 
-bool GrainWaveformCache::contains(const GrainWaveform::Key &key) {
-  std::lock_guard<std::mutex> guard(cacheMutex);
-  return map.find(key) != map.end();
+void GrainWaveformCache::cancel(const std::vector<GrainWaveform::Ptr> &waves) {
+  std::vector<GrainWaveform::Ptr> wavesToRelease;
+  std::vector<GrainWaveform::Key> keysRemoved;
+  for (auto &wave : waves) {
+    wave->cancel();
+    auto &shard = shardFor(wave->key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.map.find(wave->key);
+    if (it != shard.map.end() && it->second.wave == wave) {
+      keysRemoved.push_back(wave->key);
+      shard.eraseLocked(it, wavesToRelease);
+    }
+  }
+  notifyExpired(keysRemoved);
 }
 
 void GrainWaveformCache::store(GrainWaveform &wave) {
+  std::vector<GrainWaveform::Ptr> wavesToRelease, demotions;
+  std::vector<GrainWaveform::Key> keysRemoved;
+  auto &shard = shardFor(wave.key);
   {
-    std::lock_guard<std::mutex> guard(cacheMutex);
-    auto &slot = map[wave.key];
-    auto prevSize = slot.wave == nullptr ? 0 : slot.wave->sizeInBytes();
-    totalBytes += wave.sizeInBytes() - prevSize;
+    auto hash = GrainWaveform::Hasher()(wave.key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto &slot = shard.slotForLocked(wave.key, cleanupCounter);
+    auto bytes = wave.sizeInBytes();
+    if (slot.probation) {
+      shard.probationBytes -= slot.bytes;
+    }
+    shard.totalBytes += bytes - slot.bytes;
+    slot.bytes = bytes;
     slot.wave = wave;
+    slot.cold = nullptr;
+    slot.demoting = false;
     slot.cleanupCounter = cleanupCounter;
+
+    // Keys only asked for once wait on probation for a second request
+    slot.probation = shard.sketch.estimate(hash) < admitFrequency;
+    if (slot.probation) {
+      shard.probationBytes += bytes;
+      slot.credit = 0;
+    } else {
+      admissions++;
+      slot.credit = std::max(slot.credit, 1);
+    }
+    wave.markReady();
+    shard.evictLocked(keysRemoved, wavesToRelease, demotions);
   }
+  shard.finishDemotions(demotions, wavesToRelease);
+  notifyExpired(keysRemoved);
   {
     auto key = wave.key;
     std::lock_guard<std::mutex> guard(listenerMutex);
     listeners.call([key](Listener &l) { l.grainWaveformStored(key); });
   }
 }
+
+bool GrainWaveformCache::tryLookup(const GrainWaveform::Key &key,
+                                   const GrainWaveform::Tolerance &tolerance,
+                                   GrainWaveform::Ptr &result,
+                                   GrainWaveform::Ptr &nearest) {
+  auto hash = GrainWaveform::Hasher()(key);
+  auto &shard = shardFor(key);
+  std::unique_lock<std::mutex> guard(shard.mutex, std::try_to_lock);
+  if (!guard.owns_lock()) {
+    return false;
+  }
+  shard.sketch.increment(hash);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end() || it->second.wave == nullptr ||
+      !it->second.wave->isReady()) {
+    nearest = shard.nearestLocked(key, tolerance);
+  }
+  if (it == shard.map.end()) {
+    misses++;
+    return true;
+  }
+  auto &slot = it->second;
+  slot.cleanupCounter = cleanupCounter;
+  if (slot.wave == nullptr) {
+    // Cold, so the caller will ask for it to be promoted
+    misses++;
+  } else if (slot.wave->isReady()) {
+    hits++;
+    if (slot.probation) {
+      // Asked for again, so it has proven itself
+      slot.probation = false;
+      shard.probationBytes -= slot.bytes;
+      admissions++;
+    }
+  }
+  slot.credit = std::min(slot.credit + 1, maxCredit);
+  result = slot.wave;
+  return true;
+}
+
 GrainWaveform::Ptr
-GrainWaveformCache::lookupOrInsertEmpty(const GrainWaveform::Key &key) {
-  GrainWaveform::Ptr result;
-  bool dataFound;
+GrainWaveformCache::lookupOrInsert(GrainWaveform &placeholder) {
+  auto &shard = shardFor(placeholder.key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto &slot = shard.slotForLocked(placeholder.key, cleanupCounter);
+  slot.cleanupCounter = cleanupCounter;
+  if (slot.wave == nullptr) {
+    slot.wave = placeholder;
+  }
+  return slot.wave;
+}
+
+bool GrainWaveformCache::promote(GrainWaveform &placeholder,
+                                 SampleBufferPool &pool) {
+  std::unique_ptr<ColdWaveform> cold;
   {
-    std::lock_guard<std::mutex> guard(cacheMutex);
-    auto &slot = map[key];
-    slot.cleanupCounter = cleanupCounter;
-    if (slot.wave == nullptr) {
-      // First time visiting this slot: insert a marker and return null
-      slot.wave = new GrainWaveform(key, 0, 0);
-      result = nullptr;
-      dataFound = false;
+    auto &shard = shardFor(placeholder.key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.map.find(placeholder.key);
+    if (it == shard.map.end() || it->second.wave.get() != &placeholder ||
+        it->second.cold == nullptr ||
+        placeholder.getState() != GrainWaveform::State::pending) {
+      return false;
+    }
+    // Its bytes stay accounted for until the store below
+    cold = std::move(it->second.cold);
+  }
+  if (!placeholder.allocate(pool, cold->numChannels, cold->numSamples)) {
+    // A loader couldn't hold it either, so drop it rather than retry
+    cancel({placeholder});
+    return true;
+  }
+  cold->expand(placeholder.buffer);
+  store(placeholder);
+  return true;
+}
+
+GrainWaveform::Ptr GrainWaveformCache::peek(const GrainWaveform::Key &key) {
+  auto &shard = shardFor(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end() || it->second.wave == nullptr ||
+      it->second.wave->isEmpty()) {
+    return nullptr;
+  }
+  return it->second.wave;
+}
+
+GrainWaveformCache::Item &
+GrainWaveformCache::Shard::slotForLocked(const GrainWaveform::Key &key,
+                                         int generation) {
+  auto [it, inserted] = map.try_emplace(key);
+  if (inserted) {
+    // New keys go just behind the hand, the last place it will look
+    it->second.clockPosition = clock.insert(clockHand, key);
+    byGrain.emplace(key.grain, &*it);
+    fileLocked(key, it->second, generation);
+  }
+  return it->second;
+}
+
+void GrainWaveformCache::Shard::fileLocked(const GrainWaveform::Key &key,
+                                           Item &item, int generation) {
+  item.generation = generation;
+  generations[generation].push_back(key);
+}
+
+bool GrainWaveformCache::Shard::cleanupBatchLocked(
+    int cutoff, std::vector<GrainWaveform::Key> &keysRemoved,
+    std::vector<GrainWaveform::Ptr> &wavesToRelease) {
+  auto oldest = generations.begin();
+  if (oldest == generations.end() || oldest->first > cutoff) {
+    return false;
+  }
+  auto &keys = oldest->second;
+  for (int i = 0; i < cleanupBatchSize && !keys.empty(); i++) {
+    auto key = keys.back();
+    keys.pop_back();
+    auto it = map.find(key);
+    if (it == map.end() || it->second.generation != oldest->first) {
+      // Erased, or filed again elsewhere since
+      continue;
+    }
+    auto &item = it->second;
+    auto &wave = item.wave;
+    auto waveRefs = wave == nullptr ? 0 : wave->getReferenceCount();
+    if (item.cleanupCounter <= cutoff && waveRefs <= 1) {
+      keysRemoved.push_back(key);
+      eraseLocked(it, wavesToRelease);
     } else {
-      // Coming back to a slot we've seen but it may or may not have actual
-      // data.
-      result = slot.wave;
-      dataFound = result->buffer.getNumSamples() > 0;
+      // Used since, or still held. Either way, not worth revisiting
+      // before the next pass.
+      fileLocked(key, item, std::max(item.cleanupCounter, cutoff + 1));
     }
   }
-  {
-    std::lock_guard<std::mutex> guard(listenerMutex);
-    listeners.call([key, dataFound](Listener &l) {
-      l.grainWaveformLookup(key, dataFound);
-    });
+  if (keys.empty()) {
+    generations.erase(oldest);
+  }
+  return true;
+}
+
+GrainWaveform::Ptr GrainWaveformCache::Shard::nearestLocked(
+    const GrainWaveform::Key &key,
+    const GrainWaveform::Tolerance &tolerance) const {
+  GrainWaveform::Ptr result;
+  if (!tolerance.isEnabled()) {
+    return result;
+  }
+  float bestDistance = 0.f;
+  auto [first, last] = byGrain.equal_range(key.grain);
+  for (auto entry = first; entry != last; ++entry) {
+    auto &wave = entry->second->second.wave;
+    if (wave == nullptr || wave->isEmpty()) {
+      continue;
+    }
+    auto distance = tolerance.distance(key, entry->second->first);
+    if (distance >= 0.f && (result == nullptr || distance < bestDistance)) {
+      result = wave;
+      bestDistance = distance;
+    }
   }
   return result;
 }
 
+void GrainWaveformCache::Shard::eraseLocked(
+    Map::iterator it, std::vector<GrainWaveform::Ptr> &wavesToRelease) {
+  auto &item = it->second;
+  totalBytes -= item.bytes;
+  if (item.probation) {
+    probationBytes -= item.bytes;
+  }
+  if (item.wave != nullptr) {
+    // Voices holding a placeholder will notice and ask again
+    item.wave->cancel();
+    wavesToRelease.push_back(item.wave);
+  }
+  if (clockHand == item.clockPosition) {
+    ++clockHand;
+  }
+  clock.erase(item.clockPosition);
+  auto [first, last] = byGrain.equal_range(it->first.grain);
+  for (auto entry = first; entry != last; ++entry) {
+    if (entry->second == &*it) {
+      byGrain.erase(entry);
+      break;
+    }
+  }
+  map.erase(it);
+}
+
+void GrainWaveformCache::Shard::demoteLocked(
+    Item &item, std::vector<GrainWaveform::Ptr> &demotions) {
+  auto &buffer = item.wave->buffer;
+  auto bytes = ColdWaveform::sizeInBytes(buffer.getNumChannels(),
+                                         buffer.getNumSamples());
+  totalBytes += bytes - item.bytes;
+  item.bytes = bytes;
+  item.demoting = true;
+  demotions.push_back(item.wave);
+}
+
+void GrainWaveformCache::Shard::finishDemotions(
+    std::vector<GrainWaveform::Ptr> &demotions,
+    std::vector<GrainWaveform::Ptr> &wavesToRelease) {
+  for (auto &wave : demotions) {
+    // Ready buffers never change, so they can be read without the lock
+    auto cold = std::make_unique<ColdWaveform>(wave->buffer);
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = map.find(wave->key);
+    if (it == map.end() || it->second.wave != wave ||
+        !it->second.demoting) {
+      // Erased or replaced since, and already accounted for
+      continue;
+    }
+    auto &item = it->second;
+    item.demoting = false;
+    if (item.credit > 0) {
+      // Used while we were converting it, so keep it after all
+      auto bytes = wave->sizeInBytes();
+      totalBytes += bytes - item.bytes;
+      item.bytes = bytes;
+      continue;
+    }
+    item.cold = std::move(cold);
+    wavesToRelease.push_back(item.wave);
+    item.wave = nullptr;
+  }
+  demotions.clear();
+}
+
+void GrainWaveformCache::Shard::evictLocked(
+    std::vector<GrainWaveform::Key> &keysRemoved,
+    std::vector<GrainWaveform::Ptr> &wavesToRelease,
+    std::vector<GrainWaveform::Ptr> &demotions) {
+  // Sweep until we fit the budget, and probation fits its share. Waveforms
+  // still held by voices and placeholders for pending loads can't be
+  // evicted; after enough laps to drain everyone's credit and demote
+  // them, give up and stay over budget for now. Probation entries go as
+  // soon as the hand reaches them.
+  auto probationBudget = budgetBytes * probationPercent / 100;
+  auto stepsLeft = (maxCredit + 2) * clock.size();
+  while ((totalBytes > budgetBytes || probationBytes > probationBudget) &&
+         stepsLeft > 0) {
+    stepsLeft--;
+    if (clockHand == clock.end()) {
+      clockHand = clock.begin();
+    }
+    auto it = map.find(*clockHand);
+    jassert(it != map.end());
+    auto &item = it->second;
+    auto &wave = item.wave;
+    bool isCold = wave == nullptr && item.cold != nullptr;
+    bool isBusy = !isCold && (wave == nullptr || wave->isEmpty() ||
+                              wave->getReferenceCount() > 1 || item.demoting);
+    if (isBusy || (totalBytes <= budgetBytes && !item.probation)) {
+      ++clockHand;
+    } else if (item.credit > 0 && !item.probation) {
+      item.credit--;
+      ++clockHand;
+    } else if (!isCold && !item.probation) {
+      demoteLocked(item, demotions);
+      ++clockHand;
+    } else {
+      keysRemoved.push_back(it->first);
+      eraseLocked(it, wavesToRelease);
+    }
+  }
+}
+
+void GrainWaveformCache::notifyExpired(
+    const std::vector<GrainWaveform::Key> &keys) {
+  std::lock_guard<std::mutex> guard(listenerMutex);
+  for (auto &key : keys) {
+    listeners.call([key](Listener &l) { l.grainWaveformExpired(key); });
+  }
+}
+
+// Where frame tables go when they can't be saved beside their archive,
+// such as in a read-only library folder. Each archive gets one file, named
+// by its path, which the fingerprint inside validates.
+static juce::File frameTableCacheFile(const juce::File &archive) {
+#if JUCE_MAC
+  auto base = juce::File::getSpecialLocation(juce::File::userHomeDirectory)
+                  .getChildFile("Library/Caches");
+#else
+  auto base = juce::File::getSpecialLocation(
+      juce::File::userApplicationDataDirectory);
+#endif
+  auto name = archive.getFileName() + "-" +
+              juce::String::toHexString(
+                  archive.getFullPathName().hashCode64()) +
+              ".frames";
+  return base.getChildFile("Revertebrator").getChildFile(name);
+}
+
+static bool readFrameTable(const juce::File &file, FlacFrameIndex &frames,
+                           const FlacFrameIndex::Fingerprint &fingerprint) {
+  juce::FileInputStream in(file);
+  if (!in.openedOk()) {
+    return false;
+  }
+  juce::BufferedInputStream buf(in, 8192);
+  return frames.read(buf, fingerprint);
+}
+
+static bool writeFrameTable(const juce::File &file,
+                            const FlacFrameIndex &frames,
+                            const FlacFrameIndex::Fingerprint &fingerprint) {
+  if (!file.getParentDirectory().createDirectory()) {
+    return false;
+  }
+  juce::TemporaryFile temp(file);
+  {
+    juce::FileOutputStream out(temp.getFile());
+    if (!out.openedOk()) {
+      return false;
+    }
+    frames.write(out, fingerprint);
+    out.flush();
+    if (out.getStatus().failed()) {
+      return false;
+    }
+  }
+  return temp.overwriteTargetFileWithTemporary();
+}
+
+void GrainFrameTable::load(const GrainIndex &index) {
+  if (index.soundFormat != GrainIndex::SoundFormat::flac) {
+    // Uncompressed streams are addressed directly, no table needed
+    return;
+  }
+  // Frame tables are saved in a sidecar file, since building one means
+  // scanning the entire sound stream. If the archive's folder isn't
+  // writable, the table is kept in a per-user cache instead.
+  auto sidecar =
+      index.file.getSiblingFile(index.file.getFileName() + ".frames");
+  auto cached = frameTableCacheFile(index.file);
+  FlacFrameIndex::Fingerprint fingerprint(index.file,
+                                          index.soundFileBytes.getStart());
+  bool loaded = readFrameTable(sidecar, frames, fingerprint) ||
+                readFrameTable(cached, frames, fingerprint);
+  if (!loaded && index.soundFileData != nullptr) {
+    loaded =
+        frames.build(index.soundFileData, index.soundFileBytes.getLength());
+    if (loaded && !writeFrameTable(sidecar, frames, fingerprint)) {
+      writeFrameTable(cached, frames, fingerprint);
+    }
+  }
+  ready = loaded && frames.isValid();
+}
+
+void GrainFrameTable::openPcm(const GrainIndex &index) {
+  // Whoever gets here first once the table is ready opens it, just once
+  if (!pcmWanted || !ready || pcmOpening.exchange(true)) {
+    return;
+  }
+  auto pcmFile = index.file.getSiblingFile(index.file.getFileName() + ".pcm");
+  FlacFrameIndex::Fingerprint fingerprint(index.file,
+                                          index.soundFileBytes.getStart());
+  pcmReady = pcm.open(pcmFile, frames, fingerprint);
+}
+
+const FlacFrameIndex *GrainFrameTable::get() const {
+  return ready ? &frames : nullptr;
+}
+
+PcmSidecar *GrainFrameTable::getPcm() { return pcmReady ? &pcm : nullptr; }
+
+bool PcmSidecar::createSparseFile(const juce::File &file, juce::int64 size) {
+#if JUCE_LINUX || JUCE_MAC
+#if JUCE_MAC
+  // HFS+ has no holes, and would write out every byte
+  auto directory = file.getParentDirectory().getFullPathName();
+  if (pathconf(directory.toRawUTF8(), _PC_MIN_HOLE_SIZE) <= 0) {
+    return false;
+  }
+#endif
+  auto fd = ::open(file.getFullPathName().toRawUTF8(),
+                   O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = ::ftruncate(fd, off_t(size)) == 0;
+  ::close(fd);
+  return ok;
+#elif JUCE_WINDOWS
+  // Without the sparse flag, NTFS would zero fill the whole file
+  auto handle = CreateFileW(file.getFullPathName().toWideCharPointer(),
+                            GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  DWORD bytesReturned = 0;
+  LARGE_INTEGER end;
+  end.QuadPart = size;
+  bool ok = DeviceIoControl(handle, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0,
+                            &bytesReturned, nullptr) &&
+            SetFilePointerEx(handle, end, nullptr, FILE_BEGIN) &&
+            SetEndOfFile(handle);
+  CloseHandle(handle);
+  return ok;
+#else
+  juce::ignoreUnused(file, size);
+  return false;
+#endif
+}
+
+void GrainIndex::readAhead(const juce::Range<juce::int64> &samples) const {
+#if JUCE_LINUX || JUCE_MAC
+  if (soundFileData == nullptr) {
+    return;
+  }
+  juce::int64 start, end;
+  if (soundFormat != SoundFormat::flac) {
+    auto clipped = samples.getIntersectionWith({0, numSamples});
+    if (clipped.isEmpty()) {
+      return;
+    }
+    start = clipped.getStart() * soundBytesPerFrame();
+    end = clipped.getEnd() * soundBytesPerFrame();
+  } else {
+    // Compressed streams need a frame table to tell us which bytes to hint
+    auto table = frames.get();
+    if (table == nullptr) {
+      return;
+    }
+    auto first = table->frameForSample(samples.getStart());
+    auto last = table->frameForSample(samples.getEnd());
+    start = table->frameOffsets[first];
+    end = last + 1 < table->numFrames() ? table->frameOffsets[last + 1]
+                                        : soundFileBytes.getLength();
+  }
+
+  // The mapping itself is page aligned, but the hint must start on a page
+  static const auto pageMask = uintptr_t(sysconf(_SC_PAGESIZE)) - 1;
+  auto address = reinterpret_cast<uintptr_t>(soundFileData + start);
+  auto alignedAddress = address & ~pageMask;
+  madvise(reinterpret_cast<void *>(alignedAddress),
+          size_t(address - alignedAddress + (end - start)), MADV_WILLNEED);
+#else
+  juce::ignoreUnused(samples);
+#endif
+}
+
 static juce::String numSamplesToString(juce::uint64 samples) {
   static const struct {
     const char *prefix;
@@ -573,12 +1824,39 @@ juce::Result GrainIndex::load() {
       }
     }
   }
-  soundFileBytes = zip.getByteRange("sound.flac");
-  if (!json.isObject() || soundFileBytes.isEmpty() || grainX.isEmpty()) {
+  if (!json.isObject()) {
+    return juce::Result::fail("Wrong file format");
+  }
+  auto format = json.getProperty("sound_format", "flac").toString();
+  if (format == "flac") {
+    soundFormat = SoundFormat::flac;
+    soundFileBytes = zip.getByteRange("sound.flac");
+  } else if (format == "s16le" || format == "f32le") {
+    soundFormat = format == "s16le" ? SoundFormat::s16le : SoundFormat::f32le;
+    soundFileBytes = zip.getByteRange("sound.pcm");
+  } else {
+    return juce::Result::fail("Unsupported sound format");
+  }
+  if (soundFileBytes.isEmpty() || grainX.isEmpty()) {
     return juce::Result::fail("Wrong file format");
   }
 
+  // Map the sound stream once for all loader threads to share. If this
+  // fails, for example due to a lack of address space, loaders fall back
+  // on reading the file through their own streams.
+  soundFileMap = std::make_unique<juce::MemoryMappedFile>(
+      file, soundFileBytes, juce::MemoryMappedFile::readOnly);
+  if (soundFileMap->getData() == nullptr) {
+    soundFileMap = nullptr;
+  } else {
+    auto mapOffset =
+        soundFileBytes.getStart() - soundFileMap->getRange().getStart();
+    soundFileData =
+        static_cast<const juce::uint8 *>(soundFileMap->getData()) + mapOffset;
+  }
+
   numSamples = json.getProperty("sound_len", var());
+  soundChannels = json.getProperty("channels", 0);
   maxGrainWidth = json.getProperty("max_grain_width", var());
   auto varBinX = json.getProperty("bin_x", var());
   auto varBinF0 = json.getProperty("bin_f0", var());
@@ -603,29 +1881,28 @@ juce::Result GrainIndex::load() {
       varBinX.size() != numBins() + 1) {
     return juce::Result::fail("Bad parameters in file");
   }
+  if (soundFormat != SoundFormat::flac &&
+      (soundChannels < 1 || soundChannels > maxSoundChannels ||
+       soundFileBytes.getLength() != numSamples * soundBytesPerFrame())) {
+    return juce::Result::fail("Bad parameters in file");
+  }
   return juce::Result::ok();
 }
 
 GrainData::GrainData(juce::ThreadPool &generalPurposeThreads)
-    : indexLoaderJob(std::make_unique<IndexLoaderJob>(generalPurposeThreads)),
-      cacheCleanupJob(
-          std::make_unique<CacheCleanupJob>(generalPurposeThreads, *this)) {
-  for (auto i = juce::SystemStats::getNumCpus(); i; --i) {
-    waveformLoaderThreads.add(new WaveformLoaderThread());
-  }
-  for (auto t : waveformLoaderThreads) {
-    t->startThread();
-  }
+    : client(new Client()),
+      silenceWave(new GrainWaveform(GrainWaveform::Key{}, 0, 0)),
+      indexLoaderJob(std::make_unique<IndexLoaderJob>(
+          generalPurposeThreads, *shared, cacheBudgetBytes,
+          pcmSidecarEnabled)) {
+  audioHelperThread = std::make_unique<AudioHelperThread>(*this);
+  audioHelperThread->startThread();
 }
 
 GrainData::~GrainData() {
-  for (auto *t : waveformLoaderThreads) {
-    t->signalThreadShouldExit();
-    t->notify();
-  }
-  for (auto *t : waveformLoaderThreads) {
-    t->waitForThreadToExit(-1);
-  }
+  audioHelperThread->signalThreadShouldExit();
+  audioHelperThread->notify();
+  audioHelperThread->waitForThreadToExit(-1);
 }
 
 void GrainData::referFileInputTo(const juce::Value &v) {
@@ -638,30 +1915,65 @@ void GrainData::referToStatusOutput(juce::Value &v) {
 
 GrainIndex::Ptr GrainData::getIndex() { return indexLoaderJob->getIndex(); }
 
-GrainWaveform::Ptr GrainData::getWaveform(GrainIndex &index,
-                                          const GrainWaveform::Key &key) {
+void GrainData::setCacheBudget(juce::int64 bytes) {
+  // Applying a budget locks every shard, so skip it when nothing changed.
+  // Indexes loaded later pick up the budget themselves.
+  if (cacheBudgetBytes.exchange(bytes) == bytes) {
+    return;
+  }
+  auto index = getIndex();
+  if (index != nullptr) {
+    index->cache.setBudget(bytes);
+  }
+}
+
+void GrainData::setPcmSidecarEnabled(bool enabled) {
+  pcmSidecarEnabled = enabled;
+  auto index = getIndex();
+  if (enabled && index != nullptr && index->status.wasOk()) {
+    index->frames.requestPcm();
+    shared->openPcmSidecar(index);
+  }
+}
+
+GrainWaveform::Ptr
+GrainData::getWaveform(GrainIndex &index, const GrainWaveform::Key &key,
+                       const GrainWaveform::Tolerance &tolerance,
+                       double deadline, GrainWaveform::Ptr &standIn) {
   jassert(index.isValid());
   jassert(key.grain < index.numGrains());
 
-  auto cached = index.cache.lookupOrInsertEmpty(key);
-  if (cached == nullptr) {
-    // Totally new item, dispatch it to a rotating worker thread.
-    // The cache atomically stored a placeholder to avoid duplicating work.
-    int seq = (waveformThreadSequence += 1) % waveformLoaderThreads.size();
-    waveformLoaderThreads[seq]->addJob(
-        WaveformLoaderThread::Job{.index = index, .key = key});
-    return nullptr;
+  GrainWaveform::Ptr wave;
+  if (!index.cache.tryLookup(key, tolerance, wave, standIn) ||
+      wave != nullptr) {
+    return wave;
   }
-  if (cached->isEmpty()) {
-    // It's the placeholder item. Work is still pending.
+
+  // Totally new item. Take a spare placeholder and ask the helper thread
+  // to cache it and start loading, unless it's fallen behind.
+  if (requests.getFreeSpace() < 1 || !placeholders.pop(wave)) {
     return nullptr;
   }
-  return cached;
+  wave->key = key;
+  requests.push(Request{.index = index, .wave = wave, .deadline = deadline});
+  return wave;
+}
+
+void GrainData::retire(GrainWaveform::Ptr &wave) {
+  if (wave != nullptr && !retired.push(std::move(wave))) {
+    // Full, so the helper is far behind. Release here as a last resort.
+    jassertfalse;
+    wave = nullptr;
+  }
+}
+
+SampleBufferPool::Stats GrainData::samplePoolStats() {
+  return shared->samplePool->getStats();
 }
 
 float GrainData::averageLoadQueueDepth() {
   float totalDepth = 0., totalThreads = 0.;
-  for (auto *t : waveformLoaderThreads) {
+  for (auto *t : shared->waveformLoaderThreads) {
     totalDepth += t->loadQueueDepth();
     totalThreads += 1.f;
   }
@@ -673,6 +1985,12 @@ float GrainData::averageLoadQueueDepth() {
   }
 }
 
+float GrainData::approxLoadQueueDepth() const noexcept {
+  auto &threads = shared->waveformLoaderThreads;
+  auto queued = shared->queuedWaveformJobs.load(std::memory_order_relaxed);
+  return float(queued) / float(std::max(1, threads.size()));
+}
+
 void GrainSources::load(const juce::File &archiveFile) {
   ZipReader64 zip(archiveFile);
   if (zip.openedOk()) {
@@ -1,13 +1,79 @@
 #pragma once
 
+#include "ColdWaveform.h"
+#include "FlacFrameIndex.h"
+#include "FrequencySketch.h"
+#include "PcmSidecar.h"
+#include "ResamplerFilterBank.h"
+#include "SampleBufferPool.h"
+#include "SpscRing.h"
 #include <JuceHeader.h>
+#include <list>
+#include <map>
 
 class GrainWaveform : public juce::ReferenceCountedObject {
 public:
   using Ptr = juce::ReferenceCountedObjectPtr<GrainWaveform>;
 
-  // Chain of IIR filters to apply prior to windowing and gain normalization
-  using Filters = juce::Array<juce::IIRCoefficients>;
+  static inline void hashCombine(std::size_t &seed, std::size_t value) {
+    seed ^= value + std::size_t(0x9e3779b9) + (seed << 6) + (seed >> 2);
+  }
+
+  // IIR filters to apply prior to windowing and gain normalization, as
+  // cutoff frequencies at the output sample rate. Zero disables a filter.
+  // Keys hold this small description rather than coefficients, so they can
+  // be copied and compared without allocating.
+  struct Filters {
+    static constexpr int maxStages = 2;
+    float sampleRate, highPass, lowPass;
+
+    inline bool operator==(const Filters &o) const noexcept {
+      return sampleRate == o.sampleRate && highPass == o.highPass &&
+             lowPass == o.lowPass;
+    }
+
+    // Returns the number of stages written
+    inline int makeCoefficients(juce::IIRCoefficients *stages) const {
+      int numStages = 0;
+      if (highPass > 0.f) {
+        stages[numStages++] =
+            juce::IIRCoefficients::makeHighPass(sampleRate, highPass);
+      }
+      if (lowPass > 0.f) {
+        stages[numStages++] =
+            juce::IIRCoefficients::makeLowPass(sampleRate, lowPass);
+      }
+      return numStages;
+    }
+  };
+
+  // Raised cosine over phases -1 to 1, tabulated at a fixed resolution and
+  // linearly interpolated. Zero outside that range.
+  class RaisedCosine {
+  public:
+    static constexpr int resolution = 4096;
+
+    static inline const RaisedCosine &get() {
+      static const RaisedCosine table;
+      return table;
+    }
+
+    inline float operator()(float phase) const noexcept {
+      auto position = std::min(std::abs(phase), 1.f) * resolution;
+      auto i = std::min(int(position), resolution - 1);
+      auto frac = position - float(i);
+      return samples[i] + frac * (samples[i + 1] - samples[i]);
+    }
+
+  private:
+    float samples[resolution + 1];
+
+    inline RaisedCosine() {
+      for (int i = 0; i <= resolution; i++) {
+        samples[i] = 0.5f + 0.5f * float(std::cos(i * M_PI / resolution));
+      }
+    }
+  };
 
   // Window function, scaled to a particular size in samples
   struct Window {
@@ -18,6 +84,9 @@ public:
       float mix, width0, width1, phase1;
     };
 
+    // Single sample window, so keys can be default constructed
+    inline Window() noexcept : mix(0.f), width0(1), width1(1), phase1(0) {}
+
     inline Window(float maxWidthSamples, const Params &p)
         : mix(juce::jlimit(0.f, 1.f, p.mix)),
           width0(1 + std::round(juce::jlimit(0.f, 1.f, p.width0) *
@@ -40,6 +109,20 @@ public:
       return win0 * (1.f - mix) + win1 * mix;
     }
 
+    // Samples the window for rendering. Rather than calling cosf for each
+    // sample, both halves read from one small table of the raised cosine
+    // shared by every window, scaled to their widths.
+    inline void evaluate(int firstX, float *dest, int num) const noexcept {
+      auto &shape = RaisedCosine::get();
+      float scale0 = 1.f / width0, scale1 = 1.f / width1;
+      for (int i = 0; i < num; i++) {
+        float x = float(firstX + i);
+        auto win0 = shape(x * scale0);
+        auto win1 = shape((x - phase1) * scale1);
+        dest[i] = win0 * (1.f - mix) + win1 * mix;
+      }
+    }
+
     inline float peakValue() const noexcept {
       auto y0 = evaluate(0);
       auto y1 = evaluate(phase1 / 2);
@@ -63,6 +146,16 @@ public:
     inline juce::Range<int> range() const noexcept {
       return rangeW0().getUnionWith(rangeW1());
     }
+
+    struct Hasher {
+      inline std::size_t operator()(Window const &w) const noexcept {
+        std::size_t seed = std::hash<float>()(w.mix);
+        hashCombine(seed, std::hash<int>()(w.width0));
+        hashCombine(seed, std::hash<int>()(w.width1));
+        hashCombine(seed, std::hash<int>()(w.phase1));
+        return seed;
+      }
+    };
   };
 
   struct Key {
@@ -72,36 +165,114 @@ public:
     Filters filters;
 
     inline bool operator==(const Key &o) const noexcept {
-      if (!(grain == o.grain && speedRatio == o.speedRatio &&
-            window == o.window && filters.size() == o.filters.size())) {
-        return false;
-      }
-      for (int f = 0; f < filters.size(); f++) {
-        const auto &coeff = filters[f].coefficients;
-        for (int c = 0; c < juce::numElementsInArray(coeff); c++) {
-          if (coeff[c] != o.filters[f].coefficients[c]) {
-            return false;
-          }
-        }
-      }
-      return true;
+      return grain == o.grain && speedRatio == o.speedRatio &&
+             window == o.window && filters == o.filters;
     }
   };
 
   struct Hasher {
     inline std::size_t operator()(Key const &key) const noexcept {
-      return key.grain ^ int(key.speedRatio * 1e3) ^ int(key.window.mix * 3e3) ^
-             (key.window.width0 * 2) ^ (key.window.width1 * 3) ^
-             key.window.phase1;
+      std::size_t seed = std::hash<unsigned>()(key.grain);
+      hashCombine(seed, std::hash<float>()(key.speedRatio));
+      hashCombine(seed, Window::Hasher()(key.window));
+      hashCombine(seed, std::hash<float>()(key.filters.sampleRate));
+      hashCombine(seed, std::hash<float>()(key.filters.highPass));
+      hashCombine(seed, std::hash<float>()(key.filters.lowPass));
+      return seed;
     }
   };
 
+  // How far a cached waveform's key may be from the one we want, for it to
+  // stand in while the exact waveform loads. Each field is a fraction of
+  // the wanted value, and zero requires an exact match.
+  struct Tolerance {
+    float speedRatio, window, filterCutoff;
+
+    inline bool isEnabled() const noexcept {
+      return speedRatio > 0.f || window > 0.f || filterCutoff > 0.f;
+    }
+
+    // Differences scaled by tolerance and summed, or a negative result if
+    // the keys are out of tolerance or for different grains
+    inline float distance(const Key &want, const Key &have) const noexcept {
+      if (want.grain != have.grain ||
+          want.filters.sampleRate != have.filters.sampleRate) {
+        return -1.f;
+      }
+      auto w = want.window, h = have.window;
+      float parts[] = {
+          relative(want.speedRatio, have.speedRatio, speedRatio),
+          relative(float(w.width0), float(h.width0), window),
+          relative(float(w.width1), float(h.width1), window),
+          difference(float(w.phase1), float(h.phase1), w.width1 * window),
+          difference(w.mix, h.mix, window),
+          relative(want.filters.highPass, have.filters.highPass,
+                   filterCutoff),
+          relative(want.filters.lowPass, have.filters.lowPass, filterCutoff),
+      };
+      float sum = 0.f;
+      for (auto part : parts) {
+        if (part < 0.f) {
+          return -1.f;
+        }
+        sum += part;
+      }
+      return sum;
+    }
+
+  private:
+    static inline float difference(float a, float b, float limit) noexcept {
+      auto d = std::abs(a - b);
+      if (d == 0.f) {
+        return 0.f;
+      }
+      return d <= limit ? d / limit : -1.f;
+    }
+    static inline float relative(float a, float b, float limit) noexcept {
+      return difference(a, b, limit * std::abs(a));
+    }
+  };
+
+  // Placeholders are handed out before their audio exists. A loader fills
+  // in the buffer and then marks it ready, so voices can poll the handle
+  // they already hold without touching the cache.
+  enum class State { pending, ready, cancelled };
+
+  // A pending placeholder, with no audio yet
+  GrainWaveform(const Key &);
+  // A ready waveform with room for the given audio
   GrainWaveform(const Key &, int channels, int samples);
   ~GrainWaveform() override;
 
-  inline bool isEmpty() const noexcept { return buffer.getNumSamples() == 0; }
+  inline State getState() const noexcept {
+    return state.load(std::memory_order_acquire);
+  }
+  inline bool isReady() const noexcept { return getState() == State::ready; }
+  inline bool isEmpty() const noexcept {
+    return !isReady() || buffer.getNumSamples() == 0;
+  }
+
+  inline void markReady() noexcept {
+    auto expected = State::pending;
+    state.compare_exchange_strong(expected, State::ready,
+                                  std::memory_order_release);
+  }
+  inline void cancel() noexcept {
+    auto expected = State::pending;
+    state.compare_exchange_strong(expected, State::cancelled,
+                                  std::memory_order_release);
+  }
 
+  // Gives a placeholder's buffer storage from the pool, before rendering.
+  // Returns false, allocating nothing, for more channels than a sound
+  // stream may have.
+  bool allocate(SampleBufferPool &, int channels, int samples);
+
+  // Memory actually held, including rounding up to the pool's size class
   inline juce::int64 sizeInBytes() const noexcept {
+    if (storage != nullptr) {
+      return juce::int64(storageCapacity) * juce::int64(sizeof(float));
+    }
     return buffer.getNumSamples() * buffer.getNumChannels() * sizeof(float);
   }
 
@@ -109,43 +280,228 @@ public:
   juce::AudioBuffer<float> buffer;
 
 private:
+  std::atomic<State> state;
+  SampleBufferPool::Ptr pool;
+  float *storage{nullptr};
+  int storageCapacity{0};
+
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrainWaveform)
 };
 
+// Tables computed from a key and shared by reference count, such as
+// resampler filter banks. Tables are built on first use, and dropped by
+// cleanup once they've been inactive and unreferenced.
+template <typename KeyType, typename TableType,
+          typename Hasher = std::hash<KeyType>>
+class SharedTableCache {
+public:
+  using TablePtr = juce::ReferenceCountedObjectPtr<TableType>;
+
+  TablePtr get(const KeyType &key) {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      auto item = map.find(key);
+      if (item != map.end()) {
+        item->second.cleanupCounter = cleanupCounter;
+        return item->second.table;
+      }
+    }
+    // Build the table without the lock held. If another thread got there
+    // first, use its table instead.
+    TablePtr table = new TableType(key);
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &slot = map[key];
+    if (slot.table == nullptr) {
+      slot.table = table;
+    }
+    slot.cleanupCounter = cleanupCounter;
+    return slot.table;
+  }
+
+  void cleanup(int inactivityThreshold) {
+    // Let table deletion happen without the lock held
+    std::vector<TablePtr> tablesToRelease;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      int counter = cleanupCounter;
+      cleanupCounter = counter + 1;
+      for (auto item = map.begin(); item != map.end();) {
+        int age = counter - item->second.cleanupCounter;
+        auto &table = item->second.table;
+        if (age >= inactivityThreshold && table->getReferenceCount() <= 1) {
+          tablesToRelease.push_back(table);
+          item = map.erase(item);
+        } else {
+          ++item;
+        }
+      }
+    }
+  }
+
+private:
+  struct Item {
+    TablePtr table;
+    int cleanupCounter{0};
+  };
+
+  std::mutex mutex;
+  std::unordered_map<KeyType, Item, Hasher> map;
+  int cleanupCounter{0};
+};
+
+// Filter banks by cutoff step, see ResamplerFilterBank::cutoffStepForRatio
+using ResamplerCache = SharedTableCache<int, ResamplerFilterBank>;
+
 class GrainWaveformCache {
 public:
   class Listener {
   public:
     virtual void grainWaveformStored(const GrainWaveform::Key &) = 0;
     virtual void grainWaveformExpired(const GrainWaveform::Key &) = 0;
-    virtual void grainWaveformLookup(const GrainWaveform::Key &,
-                                     bool dataFound) = 0;
   };
 
   void addListener(Listener *);
   void removeListener(Listener *);
 
+  static constexpr juce::int64 defaultBudgetBytes = 1024 * 1024 * 1024;
+
+  struct Stats {
+    // Lookups finding a ready waveform, and lookups finding nothing
+    juce::int64 hits, misses;
+    // Waveforms that joined the protected segment
+    juce::int64 admissions;
+  };
+
   juce::int64 sizeInBytes();
+  inline Stats getStats() const noexcept {
+    return Stats{.hits = hits, .misses = misses, .admissions = admissions};
+  }
+  void setBudget(juce::int64 bytes);
   void cleanup(int inactivityThreshold);
-  void expire(const std::vector<GrainWaveform::Key> &);
+  // Drops placeholders whose loads were abandoned, if still cached
+  void cancel(const std::vector<GrainWaveform::Ptr> &);
 
+  // Publishes a placeholder once its buffer has been filled in
   void store(GrainWaveform &);
-  GrainWaveform::Ptr lookupOrInsertEmpty(const GrainWaveform::Key &);
-  bool contains(const GrainWaveform::Key &);
+
+  // Safe for the audio thread, never blocking or allocating. Returns
+  // false if the cache was busy. Otherwise 'result' is the cached
+  // waveform, which may be a pending placeholder, or null if none yet.
+  // While 'result' isn't ready, 'nearest' is the closest ready waveform
+  // for the same grain within tolerance, if any.
+  bool tryLookup(const GrainWaveform::Key &, const GrainWaveform::Tolerance &,
+                 GrainWaveform::Ptr &result, GrainWaveform::Ptr &nearest);
+
+  // Caches a new placeholder unless its key is already present, and
+  // returns whichever waveform is now cached for that key
+  GrainWaveform::Ptr lookupOrInsert(GrainWaveform &placeholder);
+
+  // Fills in and stores a cached placeholder from the cold tier, if its
+  // key has a cold copy. Returns false if it needs loading instead.
+  bool promote(GrainWaveform &placeholder, SampleBufferPool &);
+
+  // For displays: a ready waveform if one is cached, without counting as
+  // a use or starting a load
+  GrainWaveform::Ptr peek(const GrainWaveform::Key &);
 
 private:
+  // Grains are spread across independently locked shards, so loaders,
+  // cleanup, and voices rarely wait on each other. Every key for one grain
+  // lives in the same shard, so near matches can be found together.
+  static constexpr int numShards = 16;
+
+  // Replacement follows a generalized CLOCK: each use buys a waveform more
+  // trips of the hand before it can be evicted.
+  static constexpr int maxCredit = 3;
+
+  // Protected waveforms that run out of credit drop to a cold tier first,
+  // kept at 16 bits in about half the memory, and are only evicted if
+  // the hand comes round again before they're used. Using a cold entry
+  // counts as a miss, and the helper thread expands it back to floats
+  // rather than loading it again. The sweep only picks which waveforms to
+  // demote, counting them at their cold size; converting them happens
+  // after the shard is unlocked, and they stay usable until it's done.
+
+  // Admission follows TinyLFU. A waveform whose key hasn't been requested
+  // before starts out on probation, where it earns no credit and its share
+  // of the budget is small. Being looked up again, or having been popular
+  // enough recently according to the frequency sketch, makes it protected.
+  static constexpr int probationPercent = 20;
+  static constexpr int admitFrequency = 2;
+
+  // Cleanup follows generations. Each key is filed under the cleanup
+  // counter from when it was last checked, and a pass only visits the
+  // generations old enough to have expired. Uses don't refile keys, since
+  // lookups can't allocate, so a pass refiles any it finds were used since.
+  // A lock is held for at most a batch of keys at a time.
+  static constexpr int cleanupBatchSize = 256;
+
+  using Clock = std::list<GrainWaveform::Key>;
+  using Generations = std::map<int, std::vector<GrainWaveform::Key>>;
   struct Item {
     GrainWaveform::Ptr wave;
+    juce::int64 bytes{0};
     int cleanupCounter{0};
+    // Where the key is filed in the shard's generations
+    int generation{0};
+    // Set in the cold tier, where 'wave' is null until promoted
+    std::unique_ptr<ColdWaveform> cold;
+    // Picked for the cold tier, and already counted at its cold size
+    bool demoting{false};
+    int credit{0};
+    bool probation{false};
+    Clock::iterator clockPosition;
+  };
+  using Map = std::unordered_map<GrainWaveform::Key, Item,
+                                 GrainWaveform::Hasher>;
+  // Entries by grain number. Map entries don't move on rehash, so these
+  // stay valid until the entry is erased.
+  using GrainEntries = std::unordered_multimap<unsigned, Map::value_type *>;
+
+  struct Shard {
+    Item &slotForLocked(const GrainWaveform::Key &, int generation);
+    void fileLocked(const GrainWaveform::Key &, Item &, int generation);
+    // Expires or refiles keys from the oldest generation, if it's no newer
+    // than 'cutoff'. Returns false once there's nothing left to do.
+    bool cleanupBatchLocked(int cutoff, std::vector<GrainWaveform::Key> &,
+                            std::vector<GrainWaveform::Ptr> &);
+    void eraseLocked(Map::iterator, std::vector<GrainWaveform::Ptr> &);
+    void demoteLocked(Item &, std::vector<GrainWaveform::Ptr> &demotions);
+    GrainWaveform::Ptr nearestLocked(const GrainWaveform::Key &,
+                                     const GrainWaveform::Tolerance &) const;
+    // Adds waveforms picked for the cold tier to 'demotions', for the
+    // caller to pass to finishDemotions once the lock is released
+    void evictLocked(std::vector<GrainWaveform::Key> &,
+                     std::vector<GrainWaveform::Ptr> &wavesToRelease,
+                     std::vector<GrainWaveform::Ptr> &demotions);
+    // Converts waveforms to 16 bits without the lock held, then swaps in
+    // each cold copy unless its entry has changed or been used meanwhile
+    void finishDemotions(std::vector<GrainWaveform::Ptr> &demotions,
+                         std::vector<GrainWaveform::Ptr> &wavesToRelease);
+
+    std::mutex mutex;
+    Map map;
+    GrainEntries byGrain;
+    Clock clock;
+    Clock::iterator clockHand{clock.end()};
+    Generations generations;
+    FrequencySketch sketch;
+    juce::int64 totalBytes{0}, probationBytes{0};
+    juce::int64 budgetBytes{defaultBudgetBytes / numShards};
   };
 
+  inline Shard &shardFor(const GrainWaveform::Key &key) noexcept {
+    return shards[std::hash<unsigned>()(key.grain) % numShards];
+  }
+
+  void notifyExpired(const std::vector<GrainWaveform::Key> &);
+
   std::mutex listenerMutex;
   juce::ListenerList<Listener> listeners;
 
-  std::mutex cacheMutex;
-  std::unordered_map<GrainWaveform::Key, Item, GrainWaveform::Hasher> map;
-  juce::int64 totalBytes{0};
-  int cleanupCounter{0};
+  Shard shards[numShards];
+  std::atomic<int> cleanupCounter{0};
+  std::atomic<juce::int64> hits{0}, misses{0}, admissions{0};
 };
 
 class GrainSources {
@@ -158,17 +514,140 @@ private:
   juce::var data;
 };
 
+// Audio decoded from the sound stream, starting at a particular sample
+struct DecodedAudio : public juce::ReferenceCountedObject {
+  using Ptr = juce::ReferenceCountedObjectPtr<DecodedAudio>;
+
+  inline DecodedAudio(juce::int64 firstSample, int channels, int samples)
+      : firstSample(firstSample), audio(channels, samples) {}
+
+  inline DecodedAudio(juce::int64 firstSample,
+                      juce::AudioBuffer<float> &&audio)
+      : firstSample(firstSample), audio(std::move(audio)) {}
+
+  inline juce::Range<juce::int64> range() const noexcept {
+    return juce::Range<juce::int64>::withStartAndLength(firstSample,
+                                                        audio.getNumSamples());
+  }
+
+  inline juce::int64 sizeInBytes() const noexcept {
+    return audio.getNumSamples() * audio.getNumChannels() * sizeof(float);
+  }
+
+  juce::int64 firstSample;
+  juce::AudioBuffer<float> audio;
+
+private:
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedAudio)
+};
+
+// Bounded thread-safe cache of reference counted objects, which evicts the
+// least recently used objects once their total size exceeds a limit.
+template <typename KeyType, typename ObjectType> class LruObjectCache {
+public:
+  using ObjectPtr = juce::ReferenceCountedObjectPtr<ObjectType>;
+
+  LruObjectCache(juce::int64 maxBytes) : maxBytes(maxBytes) {}
+
+  juce::int64 sizeInBytes() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return totalBytes;
+  }
+
+  ObjectPtr lookup(const KeyType &key) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto item = map.find(key);
+    if (item == map.end()) {
+      return nullptr;
+    }
+    recentKeys.splice(recentKeys.begin(), recentKeys,
+                      item->second.recentPosition);
+    return item->second.object;
+  }
+
+  void store(const KeyType &key, ObjectType &object) {
+    // Let object deletion happen without the cache lock held
+    std::vector<ObjectPtr> objectsToRelease;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      auto &slot = map[key];
+      if (slot.object == nullptr) {
+        recentKeys.push_front(key);
+        slot.recentPosition = recentKeys.begin();
+      } else {
+        totalBytes -= slot.object->sizeInBytes();
+        objectsToRelease.push_back(slot.object);
+      }
+      slot.object = object;
+      totalBytes += object.sizeInBytes();
+
+      while (totalBytes > maxBytes && recentKeys.size() > 1) {
+        auto oldest = map.find(recentKeys.back());
+        jassert(oldest != map.end());
+        totalBytes -= oldest->second.object->sizeInBytes();
+        objectsToRelease.push_back(oldest->second.object);
+        map.erase(oldest);
+        recentKeys.pop_back();
+      }
+    }
+  }
+
+private:
+  struct Item {
+    ObjectPtr object;
+    typename std::list<KeyType>::iterator recentPosition;
+  };
+
+  const juce::int64 maxBytes;
+  std::mutex mutex;
+  std::unordered_map<KeyType, Item> map;
+  std::list<KeyType> recentKeys;
+  juce::int64 totalBytes{0};
+};
+
+class GrainIndex;
+
+class GrainFrameTable {
+public:
+  void load(const GrainIndex &);
+  const FlacFrameIndex *get() const;
+  PcmSidecar *getPcm();
+
+  // Marks the shared PCM sidecar as wanted, by any instance using the index
+  inline void requestPcm() noexcept { pcmWanted = true; }
+  inline bool isPcmWanted() const noexcept { return pcmWanted; }
+  // Creates or opens the sidecar, once wanted and the table is ready. This
+  // does file I/O, so it runs as its own background job.
+  void openPcm(const GrainIndex &);
+
+private:
+  FlacFrameIndex frames;
+  PcmSidecar pcm;
+  std::atomic<bool> ready{false}, pcmReady{false};
+  std::atomic<bool> pcmWanted{false}, pcmOpening{false};
+};
+
 class GrainIndex : public juce::ReferenceCountedObject {
 public:
   using Ptr = juce::ReferenceCountedObjectPtr<GrainIndex>;
 
+  // Encoding of the sound stream. Uncompressed streams are interleaved.
+  enum class SoundFormat { flac, s16le, f32le };
+  // The most channels a sound stream may have, in any format. This is
+  // FLAC's own limit, and uncompressed streams are held to it too.
+  static constexpr int maxSoundChannels = 8;
+
   GrainIndex(const juce::File &);
   ~GrainIndex() override;
 
   juce::File file;
   float maxGrainWidth{0};
   juce::int64 numSamples{0};
+  SoundFormat soundFormat{SoundFormat::flac};
+  int soundChannels{0};
   juce::Range<juce::int64> soundFileBytes;
+  std::unique_ptr<juce::MemoryMappedFile> soundFileMap;
+  const juce::uint8 *soundFileData{nullptr};
   juce::Array<unsigned> binX;
   juce::Array<float> binF0;
   juce::Array<juce::uint64> grainX;
@@ -176,6 +655,23 @@ public:
   juce::Result status;
   GrainWaveformCache cache;
   GrainSources sources;
+  GrainFrameTable frames;
+
+  // Decoded FLAC frames by frame number, and source audio spanning the
+  // widest possible window around each grain, by grain number.
+  LruObjectCache<int, DecodedAudio> frameCache{64 * 1024 * 1024};
+  LruObjectCache<unsigned, DecodedAudio> rawGrains{256 * 1024 * 1024};
+
+  inline int soundBytesPerFrame() const {
+    switch (soundFormat) {
+    case SoundFormat::s16le:
+      return soundChannels * 2;
+    case SoundFormat::f32le:
+      return soundChannels * 4;
+    default:
+      return 0;
+    }
+  }
 
   inline unsigned numBins() const { return binF0.size(); }
   inline unsigned numGrains() const { return grainX.size(); }
@@ -216,6 +712,9 @@ public:
 
   juce::String describeToString() const;
 
+  // Hint that the sound stream covering these samples will be read soon
+  void readAhead(const juce::Range<juce::int64> &samples) const;
+
 private:
   juce::Result load();
 
@@ -231,18 +730,72 @@ public:
   void referToStatusOutput(juce::Value &);
 
   GrainIndex::Ptr getIndex();
-  GrainWaveform::Ptr getWaveform(GrainIndex &, const GrainWaveform::Key &);
+  // Memory budget for rendered waveforms, applied to every loaded index.
+  // Instances on the same file share one cache, which takes the latest.
+  // Other memory isn't counted: each index also keeps up to 256 MB of raw
+  // grains and 64 MB of decoded frames, and the process keeps up to 64 MB
+  // of idle sample storage.
+  void setCacheBudget(juce::int64 bytes);
+  // Whether to share decoded audio through a sidecar file beside the
+  // archive. Off by default, since the file can get very large.
+  void setPcmSidecarEnabled(bool);
+  // Deadline is when the waveform will be needed, in milliseconds
+  // on the juce::Time::getMillisecondCounterHiRes() clock. Never blocks
+  // or allocates; the result may still be pending, and is null if the
+  // cache was busy. Ask again for waveforms that end up cancelled. While
+  // the result isn't ready, 'standIn' may be a ready waveform for a key
+  // within tolerance, to play in the meantime.
+  GrainWaveform::Ptr getWaveform(GrainIndex &, const GrainWaveform::Key &,
+                                 const GrainWaveform::Tolerance &,
+                                 double deadline, GrainWaveform::Ptr &standIn);
+  // Hands a reference from the audio thread over to a background thread
+  // to release, so waveforms are never freed inside processBlock
+  void retire(GrainWaveform::Ptr &);
+  // Ready waveform with no audio, standing in for grains that are late
+  inline GrainWaveform &silence() const noexcept { return *silenceWave; }
+  // Exact, but locks every loader's queue, so only for displays
   float averageLoadQueueDepth();
+  // From a relaxed count of queued jobs, safe for the audio thread
+  float approxLoadQueueDepth() const noexcept;
+  SampleBufferPool::Stats samplePoolStats();
 
 private:
+  class Shared;
   class IndexLoaderJob;
   class CacheCleanupJob;
   class WaveformLoaderThread;
+  class AudioHelperThread;
+
+  // One instance's claim on the shared loaders, so each gets a fair share
+  // of the backlog. Jobs hold on to it, so it outlives the instance.
+  struct Client : public juce::ReferenceCountedObject {
+    using Ptr = juce::ReferenceCountedObjectPtr<Client>;
+    std::atomic<int> queuedJobs{0};
+  };
+
+  // New waveform requested by the audio thread, for the helper to cache
+  // and hand to a loader
+  struct Request {
+    GrainIndex::Ptr index;
+    GrainWaveform::Ptr wave;
+    double deadline;
+  };
+
+  // Loaders, tables and indexes common to every instance in the process
+  juce::SharedResourcePointer<Shared> shared;
+  Client::Ptr client;
+
+  static constexpr int audioRingCapacity = 4096;
+  SpscRing<Request> requests{audioRingCapacity};
+  SpscRing<GrainWaveform::Ptr> placeholders{audioRingCapacity};
+  SpscRing<GrainWaveform::Ptr> retired{audioRingCapacity};
+  GrainWaveform::Ptr silenceWave;
 
-  juce::Atomic<int> waveformThreadSequence{0};
-  juce::OwnedArray<WaveformLoaderThread> waveformLoaderThreads;
+  std::atomic<juce::int64> cacheBudgetBytes{
+      GrainWaveformCache::defaultBudgetBytes};
+  std::atomic<bool> pcmSidecarEnabled{false};
   std::unique_ptr<IndexLoaderJob> indexLoaderJob;
-  std::unique_ptr<CacheCleanupJob> cacheCleanupJob;
+  std::unique_ptr<AudioHelperThread> audioHelperThread;
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrainData)
 };
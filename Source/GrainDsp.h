@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Sample processing kernels for preparing grain waveforms, for the steps
+// juce::FloatVectorOperations has no match for. Loops are written so the
+// compiler can vectorize them.
+class GrainDsp {
+public:
+  // Multiplies samples by the window in place, returning the sum of
+  // squares of the windowed samples, in a single pass.
+  static inline double applyWindow(float *samples, const float *window,
+                                   int num) noexcept {
+    // Independent partial sums let the loop vectorize without reordering
+    // a single dependent chain of additions.
+    static constexpr int lanes = 4;
+    double partial[lanes] = {};
+    int i = 0;
+    for (; i + lanes <= num; i += lanes) {
+      for (int j = 0; j < lanes; j++) {
+        auto y = samples[i + j] * window[i + j];
+        samples[i + j] = y;
+        partial[j] += double(y) * double(y);
+      }
+    }
+    double sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+    for (; i < num; i++) {
+      auto y = samples[i] * window[i];
+      samples[i] = y;
+      sum += double(y) * double(y);
+    }
+    return sum;
+  }
+
+  // Runs a cascade of biquad stages, from zero state, over every channel in
+  // a single pass. Each stage matches the transposed direct form II used by
+  // juce::SingleThreadedIIRFilter. Filter state stays in locals while the
+  // channels are interleaved sample by sample.
+  static inline void applyBiquadCascade(float *const *channels,
+                                        int numChannels, int num,
+                                        const juce::IIRCoefficients *stages,
+                                        int numStages) noexcept {
+    static constexpr int maxStages = 4, maxChannels = 2;
+    for (int firstStage = 0; firstStage < numStages; firstStage += maxStages) {
+      auto stagesInPass = std::min(maxStages, numStages - firstStage);
+      float c[maxStages][5];
+      for (int s = 0; s < stagesInPass; s++) {
+        for (int i = 0; i < 5; i++) {
+          c[s][i] = stages[firstStage + s].coefficients[i];
+        }
+      }
+      for (int firstCh = 0; firstCh < numChannels; firstCh += maxChannels) {
+        auto channelsInPass = std::min(maxChannels, numChannels - firstCh);
+        float v1[maxStages][maxChannels] = {}, v2[maxStages][maxChannels] = {};
+        for (int i = 0; i < num; i++) {
+          for (int ch = 0; ch < channelsInPass; ch++) {
+            auto x = channels[firstCh + ch][i];
+            for (int s = 0; s < stagesInPass; s++) {
+              auto out = c[s][0] * x + v1[s][ch];
+              v1[s][ch] = c[s][1] * x - c[s][3] * out + v2[s][ch];
+              v2[s][ch] = c[s][2] * x - c[s][4] * out;
+              x = out;
+            }
+            channels[firstCh + ch][i] = x;
+          }
+        }
+      }
+    }
+  }
+};
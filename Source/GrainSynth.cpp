@@ -61,14 +61,14 @@ float GrainSequence::Params::pitchNoise(Rng &rng, float input) const {
 }
 
 GrainWaveform::Filters GrainSequence::Params::filters(float pitch) {
-  juce::Array<juce::IIRCoefficients> results;
   auto highPassFreq = pitch * filterHighPass;
   auto lowPassFreq = pitch * filterLowPass;
+  GrainWaveform::Filters results{.sampleRate = sampleRate};
   if (highPassFreq > 0.f && highPassFreq < sampleRate / 2) {
-    results.add(juce::IIRCoefficients::makeHighPass(sampleRate, highPassFreq));
+    results.highPass = highPassFreq;
   }
   if (lowPassFreq > 0.f && lowPassFreq < sampleRate / 2) {
-    results.add(juce::IIRCoefficients::makeLowPass(sampleRate, lowPassFreq));
+    results.lowPass = lowPassFreq;
   }
   return results;
 }
@@ -130,7 +130,7 @@ GrainSynth::GrainSynth(GrainData &grainData, int numVoices) {
   }
   for (auto i = 0; i < numVoices; i++) {
     GrainSequence::Rng voiceRng(seedRng());
-    addVoice(new GrainVoice(grainData, voiceRng));
+    addVoice(new GrainVoice(grainData, telemetry, voiceRng));
   }
 }
 
@@ -197,24 +197,6 @@ void GrainSynth::handleController(int channel, int controller, int value) {
   juce::Synthesiser::handleController(channel, controller, value);
 }
 
-void GrainSynth::addListener(GrainVoice::Listener *listener) {
-  for (auto *generic : voices) {
-    auto voice = dynamic_cast<GrainVoice *>(generic);
-    if (voice) {
-      voice->addListener(listener);
-    }
-  }
-}
-
-void GrainSynth::removeListener(GrainVoice::Listener *listener) {
-  for (auto *generic : voices) {
-    auto voice = dynamic_cast<GrainVoice *>(generic);
-    if (voice) {
-      voice->removeListener(listener);
-    }
-  }
-}
-
 GrainSound::GrainSound(GrainIndex &index,
                        const MidiGrainSequence::MidiParams &params)
     : index(index), params(params) {}
@@ -223,8 +205,12 @@ GrainSound::~GrainSound() {}
 bool GrainSound::appliesToNote(int) { return true; }
 bool GrainSound::appliesToChannel(int) { return true; }
 
-GrainVoice::GrainVoice(GrainData &grainData, const GrainSequence::Rng &rng)
-    : grainData(grainData), rng(rng) {}
+GrainVoice::GrainVoice(GrainData &grainData, GrainTelemetry &telemetry,
+                       const GrainSequence::Rng &rng)
+    : grainData(grainData), telemetry(telemetry), rng(rng),
+      reservoir(grainData) {
+  grainsToRetry.reserve(64);
+}
 
 GrainVoice::~GrainVoice() {}
 
@@ -234,18 +220,23 @@ bool GrainVoice::canPlaySound(juce::SynthesiserSound *sound) {
 
 void GrainVoice::clearGrainQueue() {
   sampleOffsetInQueue = 0;
+  for (auto &grain : queue) {
+    retire(grainData, grain);
+  }
   queue.clear();
 }
 
-GrainVoice::Reservoir::Reservoir() {}
+GrainVoice::Reservoir::Reservoir(GrainData &grainData)
+    : grainData(grainData) {}
 
 void GrainVoice::Reservoir::add(const Grain &item) {
   static constexpr int sizeLimit = 32;
-  jassert(item.wave != nullptr);
+  jassert(item.isReady());
   if (set.find(item.seq.waveKey) == set.end()) {
     set.insert(item.seq.waveKey);
     grains.push_back(item);
     while (grains.size() > sizeLimit) {
+      retire(grainData, grains.front());
       grains.pop_front();
     }
   }
@@ -253,6 +244,9 @@ void GrainVoice::Reservoir::add(const Grain &item) {
 
 void GrainVoice::Reservoir::clear() {
   set.clear();
+  for (auto &grain : grains) {
+    retire(grainData, grain);
+  }
   grains.clear();
 }
 
@@ -352,13 +346,46 @@ void GrainVoice::fillQueueForSound(const GrainSound &sound) {
 }
 
 void GrainVoice::fetchQueueWaveforms(GrainSound &sound) {
+  // Each grain is due once playback reaches its timestamp in the queue
+  auto now = juce::Time::getMillisecondCounterHiRes();
+  auto millisecondsPerSample = 1000. / sound.params.common.sampleRate;
+  int queueTimestamp = 0;
+
   for (auto &grain : queue) {
-    if (grain.wave == nullptr) {
-      grain.wave = grainData.getWaveform(*sound.index, grain.seq.waveKey);
-      if (grain.wave != nullptr) {
+    if (!grain.isReady()) {
+      // Pending waveforms are polled through the handle we already hold.
+      // Only grains without one, or whose load was cancelled, ask again.
+      if (grain.wave != nullptr &&
+          grain.wave->getState() == GrainWaveform::State::cancelled) {
+        grainData.retire(grain.wave);
+      }
+      if (grain.wave == nullptr) {
+        auto samplesUntilDue =
+            std::max(0, queueTimestamp - sampleOffsetInQueue);
+        GrainWaveform::Ptr standIn;
+        grain.wave = grainData.getWaveform(
+            *sound.index, grain.seq.waveKey,
+            sound.params.common.matchTolerance,
+            now + samplesUntilDue * millisecondsPerSample, standIn);
+        if (standIn != nullptr) {
+          grainData.retire(grain.standIn);
+          grain.standIn = std::move(standIn);
+        }
+        if (grain.wave != nullptr && telemetry.isActive()) {
+          telemetry.push(GrainTelemetry::Event{
+              .type = GrainTelemetry::Event::Type::lookup,
+              .dataFound = grain.isReady(),
+              .index = sound.index.get(),
+              .key = grain.seq.waveKey,
+          });
+        }
+      }
+      if (grain.isReady()) {
+        grainData.retire(grain.standIn);
         reservoir.add(grain);
       }
     }
+    queueTimestamp += std::max(0, grain.seq.samplesUntilNextPoint);
   }
 }
 
@@ -367,7 +394,7 @@ int GrainVoice::numActiveGrainsInQueue() {
   int numActive = 0;
 
   for (auto &grain : queue) {
-    if (grain.wave == nullptr) {
+    if (!grain.isReady()) {
       // Stalled, can't be active yet
       break;
     }
@@ -389,10 +416,14 @@ int GrainVoice::numActiveGrainsInQueue() {
 void GrainVoice::trimQueueToLength(int length) {
   auto sound = dynamic_cast<GrainSound *>(getCurrentlyPlayingSound().get());
   if (sound == nullptr) {
+    for (auto &grain : queue) {
+      retire(grainData, grain);
+    }
     queue.clear();
   } else {
     auto deleteAfterLength = std::max(length, numActiveGrainsInQueue());
     while (queue.size() > deleteAfterLength) {
+      retire(grainData, queue.back());
       queue.pop_back();
     }
   }
@@ -407,41 +438,41 @@ void GrainVoice::trimAndRefillQueue(int length) {
   }
 }
 
-void GrainVoice::addListener(Listener *listener) {
-  std::lock_guard<std::mutex> guard(listenerMutex);
-  listeners.add(listener);
-}
-
-void GrainVoice::removeListener(Listener *listener) {
-  std::lock_guard<std::mutex> guard(listenerMutex);
-  listeners.remove(listener);
-}
-
 void GrainVoice::renderFromQueue(const GrainSound &sound,
                                  juce::AudioBuffer<float> &outputBuffer,
                                  int startSample, int numSamples) {
   int queueTimestamp = 0;
-  std::vector<Grain> grainsToRetry;
+  jassert(grainsToRetry.empty());
 
   for (auto &grain : queue) {
+    if (!grain.isReady() && grain.standIn != nullptr) {
+      // Play the near match now. The exact waveform keeps loading, and
+      // later grains with this key will find it.
+      grainData.retire(grain.wave);
+      grain.wave = std::move(grain.standIn);
+    }
+
     // If we don't have a waveform loaded yet, save this grain for later
     // and either stall for more time or replace the grain with another.
-    if (grain.wave == nullptr) {
+    if (!grain.isReady()) {
       grainsToRetry.push_back(grain);
 
       if (!reservoir.empty()) {
         // We can replace this grain with one from the Reservoir
+        retire(grainData, grain);
         grain = reservoir.choose(rng);
 
       } else if (queueTimestamp == 0 && sampleOffsetInQueue == 0) {
         // If we haven't actually started playing yet, we can delay starting
+        retireGrainsToRetry();
         return;
 
       } else {
         // We are already playing and there's a missing grain that overlaps
         // with grains we are already playing, so we can't just pause. Silence
         // it.
-        grain.wave = new GrainWaveform(grain.seq.waveKey, 0, 0);
+        retire(grainData, grain);
+        grain.wave = grainData.silence();
       }
     }
     if (queueTimestamp > (sampleOffsetInQueue + numSamples)) {
@@ -449,7 +480,7 @@ void GrainVoice::renderFromQueue(const GrainSound &sound,
       break;
     }
 
-    jassert(grain.wave != nullptr);
+    jassert(grain.isReady());
     auto &wave = *grain.wave;
     auto &gains = grain.seq.gains;
     auto srcSize = wave.buffer.getNumSamples();
@@ -462,13 +493,14 @@ void GrainVoice::renderFromQueue(const GrainSound &sound,
     auto copyDest = std::max<int>(0, relative);
     auto copySize = std::min(numSamples - copyDest, srcSize - copySource);
 
-    {
-      std::lock_guard<std::mutex> guard(listenerMutex);
-      auto range = juce::Range<int>::withStartAndLength(-relative, copySize);
-      listeners.call(
-          [this, &sound, &wave, seq = grain.seq, range](Listener &l) {
-            l.grainVoicePlaying(*this, sound, wave, seq, range);
-          });
+    if (copySize > 0 && !wave.isEmpty() && telemetry.isActive()) {
+      telemetry.push(GrainTelemetry::Event{
+          .type = GrainTelemetry::Event::Type::playing,
+          .index = sound.index.get(),
+          .key = wave.key,
+          .gains = gains,
+          .samples = juce::Range<int>::withStartAndLength(-relative, copySize),
+      });
     }
 
     if (copySize > 0) {
@@ -490,7 +522,7 @@ void GrainVoice::renderFromQueue(const GrainSound &sound,
   sampleOffsetInQueue += numSamples;
   while (!queue.empty()) {
     auto &grain = queue.front();
-    if (grain.wave == nullptr) {
+    if (!grain.isReady()) {
       break;
     }
     if (sampleOffsetInQueue < grain.wave->buffer.getNumSamples()) {
@@ -501,19 +533,36 @@ void GrainVoice::renderFromQueue(const GrainSound &sound,
     auto next = grain.seq.samplesUntilNextPoint;
     if (next < 1) {
       // No repeats, we're entirely done
+      for (auto &done : queue) {
+        retire(grainData, done);
+      }
       queue.clear();
       sequence = nullptr;
     } else {
       sampleOffsetInQueue -= next;
+      retire(grainData, grain);
       queue.pop_front();
     }
   }
 
   // If we would like to retry grains, requeue them but only if there is
   // spare capacity in the thread pool, it doesn't help to add to a backlog.
-  if (!grainsToRetry.empty() && grainData.averageLoadQueueDepth() < 1.f) {
+  if (!grainsToRetry.empty() && grainData.approxLoadQueueDepth() < 1.f) {
     for (auto &grain : grainsToRetry) {
       queue.push_back(grain);
     }
   }
+  retireGrainsToRetry();
+}
+
+void GrainVoice::retireGrainsToRetry() {
+  for (auto &grain : grainsToRetry) {
+    retire(grainData, grain);
+  }
+  grainsToRetry.clear();
+}
+
+void GrainVoice::retire(GrainData &grainData, Grain &grain) {
+  grainData.retire(grain.wave);
+  grainData.retire(grain.standIn);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GrainData.h"
+#include "GrainTelemetry.h"
 #include <JuceHeader.h>
 #include <deque>
 #include <random>
@@ -23,6 +24,7 @@ public:
     float selSpread, pitchSpread, stereoSpread;
     float speedWarp, stereoCenter, gainDbLow, gainDbHigh;
     float filterHighPass, filterLowPass;
+    GrainWaveform::Tolerance matchTolerance;
 
     float speedRatio(const GrainIndex &, unsigned grain) const;
     float maxGrainWidthSamples(const GrainIndex &) const;
@@ -97,7 +99,7 @@ private:
 
 class GrainVoice : public juce::SynthesiserVoice {
 public:
-  GrainVoice(GrainData &, const GrainSequence::Rng &);
+  GrainVoice(GrainData &, GrainTelemetry &, const GrainSequence::Rng &);
   ~GrainVoice() override;
 
   bool canPlaySound(juce::SynthesiserSound *) override;
@@ -108,34 +110,33 @@ public:
   void controllerMoved(int, int) override;
   void renderNextBlock(juce::AudioBuffer<float> &, int, int) override;
 
-  class Listener {
-  public:
-    virtual void grainVoicePlaying(const GrainVoice &, const GrainSound &,
-                                   GrainWaveform &,
-                                   const GrainSequence::Point &,
-                                   const juce::Range<int> &samples) = 0;
-  };
-
-  void addListener(Listener *);
-  void removeListener(Listener *);
   void startTouch(const TouchGrainSequence::TouchEvent &event);
   void clearGrainQueue();
 
 private:
   struct Grain {
     GrainSequence::Point seq;
+    // Null until requested, then possibly a pending placeholder
     GrainWaveform::Ptr wave;
+    // A ready waveform for a nearby key, to play if 'wave' isn't ready
+    // in time
+    GrainWaveform::Ptr standIn;
+
+    inline bool isReady() const noexcept {
+      return wave != nullptr && wave->isReady();
+    }
   };
 
   class Reservoir {
   public:
-    Reservoir();
+    Reservoir(GrainData &);
     void add(const Grain &);
     void clear();
     bool empty() const;
     const Grain &choose(GrainSequence::Rng &) const;
 
   private:
+    GrainData &grainData;
     std::deque<Grain> grains;
     std::unordered_set<GrainWaveform::Key, GrainWaveform::Hasher> set;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Reservoir);
@@ -148,16 +149,18 @@ private:
   void trimAndRefillQueue(int);
   void renderFromQueue(const GrainSound &, juce::AudioBuffer<float> &, int,
                        int);
+  void retireGrainsToRetry();
+  static void retire(GrainData &, Grain &);
 
   GrainData &grainData;
-
-  std::mutex listenerMutex;
-  juce::ListenerList<Listener> listeners;
+  GrainTelemetry &telemetry;
 
   GrainSequence::Rng rng;
   GrainSequence::Ptr sequence;
   std::deque<Grain> queue;
   Reservoir reservoir;
+  // Kept between blocks so its storage is reused
+  std::vector<Grain> grainsToRetry;
 
   int sampleOffsetInQueue{0};
   int currentModWheelPosition{0};
@@ -179,8 +182,9 @@ public:
   GrainSound::Ptr latestSound();
 
   void touchEvent(const TouchEvent &);
-  void addListener(GrainVoice::Listener *);
-  void removeListener(GrainVoice::Listener *);
+
+  // Live events from every voice, for the editor
+  GrainTelemetry telemetry;
 
   void noteOn(int, int, float) override;
   void handleController(int, int, int) override;
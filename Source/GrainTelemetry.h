@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GrainData.h"
+#include "SpscRing.h"
+#include <JuceHeader.h>
+
+// Events from the audio thread for the editor's live displays. Voices push
+// small plain events into a single-producer ring without locking or
+// allocating, and a message thread timer drains them to listeners at frame
+// rate. If the ring fills up, events are dropped rather than making the
+// audio thread wait. Nothing is recorded while there are no listeners.
+class GrainTelemetry : private juce::Timer {
+public:
+  static constexpr int capacity = 1 << 14;
+  static constexpr int drainsPerSecond = 30;
+
+  struct Event {
+    enum class Type : juce::uint8 { lookup, playing };
+
+    Type type;
+    // For lookups, whether the waveform was ready
+    bool dataFound;
+    // Only for identifying which index the event belongs to. Never
+    // dereference this, the index may be gone by the time we drain.
+    const GrainIndex *index;
+    GrainWaveform::Key key;
+    // For playback, the channel gains and sample range played this block
+    std::array<float, 2> gains;
+    juce::Range<int> samples;
+  };
+
+  class Listener {
+  public:
+    // Called on the message thread with every event since the last batch
+    virtual void grainTelemetry(const std::vector<Event> &) = 0;
+  };
+
+  inline GrainTelemetry() : ring(capacity) {
+    batch.reserve(size_t(capacity));
+  }
+  inline ~GrainTelemetry() override { stopTimer(); }
+
+  // Message thread only
+  inline void addListener(Listener *listener) {
+    listeners.add(listener);
+    active = true;
+    startTimerHz(drainsPerSecond);
+  }
+
+  inline void removeListener(Listener *listener) {
+    listeners.remove(listener);
+    if (listeners.isEmpty()) {
+      active = false;
+      stopTimer();
+    }
+  }
+
+  // Audio thread only
+  inline bool isActive() const noexcept {
+    return active.load(std::memory_order_relaxed);
+  }
+
+  inline void push(const Event &event) noexcept { ring.push(event); }
+
+private:
+  SpscRing<Event> ring;
+  std::vector<Event> batch;
+  std::atomic<bool> active{false};
+  juce::ListenerList<Listener> listeners;
+
+  inline void timerCallback() override {
+    batch.clear();
+    Event event;
+    while (batch.size() < size_t(capacity) && ring.pop(event)) {
+      batch.push_back(event);
+    }
+    if (!batch.empty()) {
+      listeners.call([this](Listener &l) { l.grainTelemetry(batch); });
+    }
+  }
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrainTelemetry)
+};
@@ -247,17 +247,17 @@ private:
 };
 
 class MapPanel::LiveOverlay : private GrainWaveformCache::Listener,
-                              private GrainVoice::Listener {
+                              private GrainTelemetry::Listener {
 public:
   LiveOverlay(GrainIndex &index, GrainSynth &synth)
       : index(index), synth(synth) {
     index.cache.addListener(this);
-    synth.addListener(this);
+    synth.telemetry.addListener(this);
   }
 
   ~LiveOverlay() {
     index->cache.removeListener(this);
-    synth.removeListener(this);
+    synth.telemetry.removeListener(this);
   }
 
   GrainIndex::Ptr index;
@@ -316,30 +316,28 @@ private:
     collector.stopLoading.add(key.grain);
   }
 
-  void grainWaveformLookup(const GrainWaveform::Key &key,
-                           bool dataFound) override {
-    jassert(key.grain < index->numGrains());
-    std::lock_guard<std::mutex> guard(collector.mutex);
-    if (dataFound) {
-      collector.visited.add(key.grain);
-    } else {
-      collector.startLoading.add(key.grain);
-    }
-  }
-
   void grainWaveformExpired(const GrainWaveform::Key &key) override {
     jassert(key.grain < index->numGrains());
     std::lock_guard<std::mutex> guard(collector.mutex);
     collector.stopLoading.add(key.grain);
   }
 
-  void grainVoicePlaying(const GrainVoice &, const GrainSound &sound,
-                         GrainWaveform &wave, const GrainSequence::Point &,
-                         const juce::Range<int> &) override {
-    if (index == sound.index) {
-      jassert(wave.key.grain < index->numGrains());
-      std::lock_guard<std::mutex> guard(collector.mutex);
-      collector.playing.add(wave.key.grain);
+  void grainTelemetry(
+      const std::vector<GrainTelemetry::Event> &events) override {
+    using Type = GrainTelemetry::Event::Type;
+    std::lock_guard<std::mutex> guard(collector.mutex);
+    for (auto &event : events) {
+      if (event.index != index.get() ||
+          event.key.grain >= index->numGrains()) {
+        continue;
+      }
+      if (event.type == Type::playing) {
+        collector.playing.add(event.key.grain);
+      } else if (event.dataFound) {
+        collector.visited.add(event.key.grain);
+      } else {
+        collector.startLoading.add(event.key.grain);
+      }
     }
   }
 };
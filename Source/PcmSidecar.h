@@ -0,0 +1,172 @@
+#pragma once
+
+#include "FlacFrameIndex.h"
+#include <JuceHeader.h>
+
+// Decoded 16-bit PCM for every frame of a FLAC stream, kept in a sparse
+// sidecar file next to the archive. Frames are filled in as they get
+// decoded, and the file is mapped shared so every process and plugin
+// instance using the same archive can skip decoding them again. Only used
+// when the user asks for it, since it can grow as large as the decoded
+// stream.
+class PcmSidecar {
+public:
+  static constexpr int magic = 0x50565652; // "RVVP"
+  static constexpr int version = 1;
+  static constexpr int headerSize = 4096;
+
+  inline bool isOpen() const noexcept { return map != nullptr; }
+
+  inline bool open(const juce::File &file, const FlacFrameIndex &frames,
+                   const FlacFrameIndex::Fingerprint &fingerprint) {
+    map = nullptr;
+    if (!frames.isValid() || frames.bitsPerSample > 16) {
+      return false;
+    }
+    blockSize = frames.blockSize;
+    channels = frames.channels;
+    numFrames = frames.numFrames();
+    totalSamples = frames.totalSamples;
+    auto size = fileSize();
+
+    if (!hasMatchingHeader(file, fingerprint, size)) {
+      // Start a new empty sidecar, but only with plenty of room to fill it.
+      // The file must be sparse, so disk is only used as frames are
+      // written. Where that isn't supported, we go without.
+      if (file.getBytesFreeOnVolume() < 2 * size) {
+        return false;
+      }
+      juce::TemporaryFile temp(file);
+      if (!createSparseFile(temp.getFile(), size)) {
+        return false;
+      }
+      {
+        // Opening an existing file doesn't truncate it
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk() || !out.setPosition(0)) {
+          return false;
+        }
+        writeHeader(out, fingerprint);
+        out.flush();
+        if (out.getStatus().failed()) {
+          return false;
+        }
+      }
+      if (!temp.overwriteTargetFileWithTemporary()) {
+        return false;
+      }
+      if (!hasMatchingHeader(file, fingerprint, size)) {
+        return false;
+      }
+    }
+
+    map = std::make_unique<juce::MemoryMappedFile>(
+        file, juce::MemoryMappedFile::readWrite, false);
+    if (map->getData() == nullptr || map->getSize() != size_t(size)) {
+      map = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  // Converts a frame from the sidecar into audio, if any process has
+  // written that frame yet.
+  inline bool readFrame(int frame, juce::AudioBuffer<float> &audio) const {
+    jassert(isOpen() && frame >= 0 && frame < numFrames);
+    if (flags()[frame] == 0) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto samples = frameLength(frame);
+    audio.setSize(channels, samples, false, false, true);
+    for (int ch = 0; ch < channels; ch++) {
+      auto input = framePcm(frame, ch);
+      auto output = audio.getWritePointer(ch);
+      for (int i = 0; i < samples; i++) {
+        output[i] = input[i];
+      }
+    }
+    return true;
+  }
+
+  // Stores a decoded frame, which holds integer sample values
+  inline void writeFrame(int frame, const juce::AudioBuffer<float> &audio) {
+    jassert(isOpen() && frame >= 0 && frame < numFrames);
+    auto samples = frameLength(frame);
+    if (audio.getNumChannels() != channels ||
+        audio.getNumSamples() != samples || flags()[frame] != 0) {
+      return;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+      auto input = audio.getReadPointer(ch);
+      auto output = framePcm(frame, ch);
+      for (int i = 0; i < samples; i++) {
+        output[i] = juce::int16(input[i]);
+      }
+    }
+    // Readers in other processes must never see the flag before the audio
+    std::atomic_thread_fence(std::memory_order_release);
+    flags()[frame] = 1;
+  }
+
+private:
+  std::unique_ptr<juce::MemoryMappedFile> map;
+
+  // Creates or replaces a file of the given size that takes up no disk
+  // space until written. Returns false if the file system can't do that.
+  // Defined with the other platform specific code in GrainData.cpp.
+  static bool createSparseFile(const juce::File &, juce::int64 size);
+  int blockSize{0}, channels{0}, numFrames{0};
+  juce::int64 totalSamples{0};
+
+  inline juce::int64 pcmOffset() const noexcept {
+    // One flag byte per frame, then page aligned PCM
+    return headerSize + ((juce::int64(numFrames) + headerSize - 1) /
+                         headerSize * headerSize);
+  }
+
+  inline juce::int64 fileSize() const noexcept {
+    return pcmOffset() + juce::int64(numFrames) * blockSize * channels *
+                             juce::int64(sizeof(juce::int16));
+  }
+
+  inline int frameLength(int frame) const noexcept {
+    return int(std::min<juce::int64>(
+        blockSize, totalSamples - juce::int64(frame) * blockSize));
+  }
+
+  inline volatile juce::uint8 *flags() const noexcept {
+    return static_cast<juce::uint8 *>(map->getData()) + headerSize;
+  }
+
+  inline juce::int16 *framePcm(int frame, int channel) const noexcept {
+    auto pcm = reinterpret_cast<juce::int16 *>(
+        static_cast<juce::uint8 *>(map->getData()) + pcmOffset());
+    return pcm + (juce::int64(frame) * channels + channel) * blockSize;
+  }
+
+  inline void writeHeader(juce::OutputStream &out,
+                          const FlacFrameIndex::Fingerprint &fp) const {
+    out.writeInt(magic);
+    out.writeInt(version);
+    fp.write(out);
+    out.writeInt(blockSize);
+    out.writeInt(channels);
+    out.writeInt(numFrames);
+    out.writeInt64(totalSamples);
+  }
+
+  inline bool hasMatchingHeader(const juce::File &file,
+                                const FlacFrameIndex::Fingerprint &fp,
+                                juce::int64 size) const {
+    if (file.getSize() != size) {
+      return false;
+    }
+    juce::FileInputStream in(file);
+    FlacFrameIndex::Fingerprint actual;
+    return in.openedOk() && in.readInt() == magic &&
+           in.readInt() == version && actual.read(in) && actual == fp &&
+           in.readInt() == blockSize && in.readInt() == channels &&
+           in.readInt() == numFrames && in.readInt64() == totalSamples;
+  }
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Polyphase windowed sinc filter for resampling. Coefficients are
+// tabulated for evenly spaced fractional source positions and interpolated
+// between neighbouring phases. When reading faster than the source rate,
+// the cutoff drops to keep aliasing out.
+//
+// Banks depend only on the cutoff, so one is shared by every speed ratio
+// that rounds to the same cutoff step. Ratios up to 1 all use step 0, at
+// full bandwidth; faster ratios round their cutoff down to a half
+// semitone step, never letting more through than the exact ratio would.
+class ResamplerFilterBank : public juce::ReferenceCountedObject {
+public:
+  using Ptr = juce::ReferenceCountedObjectPtr<ResamplerFilterBank>;
+
+  static constexpr int numPhases = 256;
+  static constexpr int zeroCrossings = 16;
+  static constexpr int cutoffStepsPerOctave = 24;
+
+  static inline int cutoffStepForRatio(float speedRatio) noexcept {
+    if (speedRatio <= 1.f) {
+      return 0;
+    }
+    // Ratios within rounding error of a step stay on it
+    auto steps = cutoffStepsPerOctave * std::log2(double(speedRatio));
+    return int(std::ceil(steps - 1e-6));
+  }
+
+  static inline double cutoffForStep(int cutoffStep) noexcept {
+    return std::exp2(-double(cutoffStep) / cutoffStepsPerOctave);
+  }
+
+  // Taps needed on either side of a source position at this speed ratio
+  static inline int halfTapsForRatio(float speedRatio) noexcept {
+    return halfTapsForStep(cutoffStepForRatio(speedRatio));
+  }
+
+  explicit inline ResamplerFilterBank(int cutoffStep)
+      : cutoffStep(cutoffStep), halfTaps(halfTapsForStep(cutoffStep)),
+        numTaps(2 * halfTaps),
+        coefficients(size_t((numPhases + 1) * numTaps)) {
+    auto cutoff = cutoffForStep(cutoffStep);
+    for (int phase = 0; phase <= numPhases; phase++) {
+      auto row = &coefficients[size_t(phase * numTaps)];
+      auto frac = double(phase) / numPhases;
+      double sum = 0.;
+      for (int k = 0; k < numTaps; k++) {
+        auto distance = (k - halfTaps + 1) - frac;
+        auto x = distance * cutoff * juce::MathConstants<double>::pi;
+        auto sinc = x == 0. ? 1. : std::sin(x) / x;
+        auto u = distance / halfTaps * juce::MathConstants<double>::pi;
+        auto blackman = 0.;
+        if (std::abs(distance) < halfTaps) {
+          blackman = 0.42 + 0.5 * std::cos(u) + 0.08 * std::cos(2. * u);
+        }
+        row[k] = float(sinc * blackman);
+        sum += row[k];
+      }
+      // Unity gain at DC for every phase
+      for (int k = 0; k < numTaps; k++) {
+        row[k] = float(row[k] / sum);
+      }
+    }
+  }
+
+  // Source samples read while producing numSamples outputs, starting at
+  // a position relative to the same origin.
+  inline juce::Range<juce::int64> footprint(float speedRatio,
+                                            double firstPosition,
+                                            int numSamples) const noexcept {
+    auto lastPosition = firstPosition + (numSamples - 1) * double(speedRatio);
+    return juce::Range<juce::int64>(
+        juce::int64(std::floor(firstPosition)) - halfTaps + 1,
+        juce::int64(std::floor(lastPosition)) + halfTaps + 1);
+  }
+
+  // Resamples every channel in one pass. Input pointers refer to the
+  // start of the footprint, and positions are relative to that. 'taps' is
+  // the caller's scratch space for numTaps coefficients, so banks can be
+  // shared between threads without allocating on each call.
+  inline void process(float speedRatio, const float *const *input,
+                      int numChannels, double firstPosition,
+                      float *const *output, int numSamples,
+                      float *taps) const noexcept {
+    jassert(cutoffStepForRatio(speedRatio) == cutoffStep);
+    jassert(std::floor(firstPosition) - halfTaps + 1 >= 0.);
+    if (speedRatio == 1.f && firstPosition == std::floor(firstPosition)) {
+      // Bypass, only copying whole samples
+      auto offset = int(firstPosition);
+      for (int ch = 0; ch < numChannels; ch++) {
+        juce::FloatVectorOperations::copy(output[ch], input[ch] + offset,
+                                          numSamples);
+      }
+      return;
+    }
+
+    for (int i = 0; i < numSamples; i++) {
+      auto position = firstPosition + i * double(speedRatio);
+      auto whole = std::floor(position);
+      auto phasePosition = (position - whole) * numPhases;
+      auto phase = std::min(numPhases - 1, int(phasePosition));
+      auto t = float(phasePosition - phase);
+
+      // Blend neighbouring phases once, for use on every channel
+      auto row0 = &coefficients[size_t(phase * numTaps)];
+      auto row1 = row0 + numTaps;
+      for (int k = 0; k < numTaps; k++) {
+        taps[k] = row0[k] + t * (row1[k] - row0[k]);
+      }
+
+      auto first = int(whole) - halfTaps + 1;
+      for (int ch = 0; ch < numChannels; ch++) {
+        auto src = input[ch] + first;
+        float acc = 0.f;
+        for (int k = 0; k < numTaps; k++) {
+          acc += src[k] * taps[k];
+        }
+        output[ch][i] = acc;
+      }
+    }
+  }
+
+  const int cutoffStep, halfTaps, numTaps;
+
+private:
+  std::vector<float> coefficients;
+
+  static inline int halfTapsForStep(int cutoffStep) noexcept {
+    return int(std::ceil(zeroCrossings / cutoffForStep(cutoffStep) - 1e-6));
+  }
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResamplerFilterBank)
+};
@@ -90,8 +90,18 @@ private:
     auto load = grainData.averageLoadQueueDepth();
     auto index = grainData.getIndex();
     auto cached = index == nullptr ? 0 : index->cache.sizeInBytes();
+    auto cache = index == nullptr ? GrainWaveformCache::Stats{}
+                                  : index->cache.getStats();
+    auto cacheHits = cache.hits / float(std::max<juce::int64>(
+                                      1, cache.hits + cache.misses));
+    auto pool = grainData.samplePoolStats();
+    auto poolHits = pool.hits / float(std::max<juce::int64>(
+                                    1, pool.hits + pool.misses));
     auto text = juce::String(load, 2) + " load, " +
-                juce::String(cached / float(1024 * 1024), 1) + "MB cache";
+                juce::String(cached / float(1024 * 1024), 1) + "MB cache, " +
+                juce::String(int(cacheHits * 100)) + "% hits, " +
+                juce::String(pool.bytesResident / float(1024 * 1024), 1) +
+                "MB pool, " + juce::String(int(poolHits * 100)) + "% reuse";
     label.setText(text, juce::NotificationType::dontSendNotification);
   }
 };
@@ -110,6 +120,20 @@ public:
 
     grainDataSrc.referTo(p.state.state.getChildWithName("grain_data")
                              .getPropertyAsValue("src", nullptr));
+    pcmSidecar.getToggleStateValue().referTo(
+        p.state.state.getChildWithName("grain_data")
+            .getPropertyAsValue("pcm_sidecar", nullptr));
+    // Budgets double in steps, so choosing one applies it only once
+    for (int mb = RvvProcessor::minCacheBudgetMB;
+         mb <= RvvProcessor::maxCacheBudgetMB; mb *= 2) {
+      auto text = mb < 1024 ? juce::String(mb) + " MB cache"
+                            : juce::String(mb / 1024) + " GB cache";
+      cacheBudget.addItem(text, mb);
+    }
+    cacheBudget.setTextWhenNothingSelected("Custom cache");
+    cacheBudget.getSelectedIdAsValue().referTo(
+        p.state.state.getChildWithName("grain_data")
+            .getPropertyAsValue("cache_budget_mb", nullptr));
     p.grainData.referToStatusOutput(grainDataStatus);
     grainDataSrc.addListener(this);
     grainDataStatus.addListener(this);
@@ -119,13 +143,18 @@ public:
 
     addAndMakeVisible(info);
     addAndMakeVisible(filename);
+    addAndMakeVisible(cacheBudget);
+    addAndMakeVisible(pcmSidecar);
     addAndMakeVisible(status);
   }
 
   void resized() override {
-    juce::FlexBox outer, inner;
+    juce::FlexBox outer, top, inner;
     outer.flexDirection = juce::FlexBox::Direction::column;
-    outer.items.add(juce::FlexItem(filename).withMinHeight(24));
+    outer.items.add(juce::FlexItem(top).withMinHeight(24));
+    top.items.add(juce::FlexItem(filename).withFlex(1));
+    top.items.add(juce::FlexItem(cacheBudget).withWidth(120));
+    top.items.add(juce::FlexItem(pcmSidecar).withWidth(170));
     outer.items.add(juce::FlexItem(inner).withFlex(1));
     inner.items.add(juce::FlexItem(info).withFlex(3));
     inner.items.add(juce::FlexItem(status).withFlex(1).withMaxWidth(170));
@@ -136,6 +165,8 @@ private:
   juce::ValueTree recentItems;
   juce::Value grainDataSrc, grainDataStatus;
   juce::Label info;
+  juce::ComboBox cacheBudget;
+  juce::ToggleButton pcmSidecar{"Share decoded audio"};
   StatusPanel status;
   juce::FilenameComponent filename{
       {}, {}, false, false, false, "*.rvv", "", "Choose grain data..."};
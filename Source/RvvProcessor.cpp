@@ -61,10 +61,32 @@ RvvProcessor::RvvProcessor()
                 std::make_unique<juce::AudioParameterFloat>(
                     "filter_lowpass", "Low Pass",
                     juce::NormalisableRange<float>(0.0f, 20.0f), 20.f),
+                std::make_unique<juce::AudioParameterFloat>(
+                    "match_speed", "Match Speed",
+                    juce::NormalisableRange<float>(0.0f, 0.1f), 0.f),
+                std::make_unique<juce::AudioParameterFloat>(
+                    "match_window", "Match Window",
+                    juce::NormalisableRange<float>(0.0f, 0.1f), 0.f),
+                std::make_unique<juce::AudioParameterFloat>(
+                    "match_filter", "Match Filter",
+                    juce::NormalisableRange<float>(0.0f, 0.25f), 0.f),
             }),
       grainData(generalPurposeThreads), synth(grainData, 512) {
 
-  state.state.appendChild({"grain_data", {{"src", ""}}, {}}, nullptr);
+  // Resource settings aren't sound parameters, so they're kept in the
+  // state tree where hosts can't automate them. The PCM sidecar writes
+  // beside the archive, so it's only used when asked for.
+  state.state.appendChild(
+      {
+          "grain_data",
+          {
+              {"src", ""},
+              {"cache_budget_mb", defaultCacheBudgetMB},
+              {"pcm_sidecar", false},
+          },
+          {},
+      },
+      nullptr);
   state.state.appendChild({"recent_files", {}, {}}, nullptr);
   state.state.appendChild(
       {
@@ -76,6 +98,7 @@ RvvProcessor::RvvProcessor()
       nullptr);
 
   attachToState();
+  updateGrainDataSettings();
   grainData.referToStatusOutput(grainDataStatus);
   grainDataStatus.addListener(this);
 }
@@ -129,12 +152,19 @@ void RvvProcessor::setStateInformation(const void *data, int sizeInBytes) {
   if (auto xml = getXmlFromBinary(data, sizeInBytes))
     state.replaceState(juce::ValueTree::fromXml(*xml));
   attachToState();
+  updateGrainDataSettings();
   updateSoundFromState();
 }
 
 void RvvProcessor::valueTreePropertyChanged(juce::ValueTree &,
-                                            const juce::Identifier &) {
-  // Something changed in the state tree, assume it affects sound parameters
+                                            const juce::Identifier &property) {
+  if (property == juce::Identifier("cache_budget_mb") ||
+      property == juce::Identifier("pcm_sidecar")) {
+    updateGrainDataSettings();
+    return;
+  }
+  // Something else changed in the state tree, assume it affects sound
+  // parameters
   updateSoundFromState();
 }
 
@@ -149,7 +179,25 @@ void RvvProcessor::attachToState() {
   state.state.addListener(this);
 }
 
+void RvvProcessor::updateGrainDataSettings() {
+  auto settings = state.state.getChildWithName("grain_data");
+  int cacheBudgetMB =
+      settings.getProperty("cache_budget_mb", defaultCacheBudgetMB);
+  cacheBudgetMB = juce::jlimit(minCacheBudgetMB, maxCacheBudgetMB,
+                               cacheBudgetMB);
+  grainData.setCacheBudget(juce::int64(cacheBudgetMB) * 1024 * 1024);
+  grainData.setPcmSidecarEnabled(settings.getProperty("pcm_sidecar", false));
+}
+
 void RvvProcessor::updateSoundFromState() {
+  // Relative differences allowed for a cached waveform to stand in while
+  // the exact one loads. All zero means exact matches only.
+  auto matchTolerance = GrainWaveform::Tolerance{
+      .speedRatio = state.getParameterAsValue("match_speed").getValue(),
+      .window = state.getParameterAsValue("match_window").getValue(),
+      .filterCutoff = state.getParameterAsValue("match_filter").getValue(),
+  };
+
   GrainIndex::Ptr index = grainData.getIndex();
   if (index != nullptr && index->isValid()) {
     auto windowParams = GrainWaveform::Window::Params{
@@ -174,6 +222,7 @@ void RvvProcessor::updateSoundFromState() {
         .filterHighPass =
             state.getParameterAsValue("filter_highpass").getValue(),
         .filterLowPass = state.getParameterAsValue("filter_lowpass").getValue(),
+        .matchTolerance = matchTolerance,
     };
     auto midiParams = MidiGrainSequence::MidiParams{
         .common = commonParams,
@@ -39,6 +39,11 @@ public:
 
   void touchEvent(const GrainSynth::TouchEvent &event);
 
+  // Limits for grain_data/cache_budget_mb, the memory for rendered
+  // waveforms. See GrainData::setCacheBudget for what else is on top.
+  static constexpr int minCacheBudgetMB = 64, maxCacheBudgetMB = 16384;
+  static constexpr int defaultCacheBudgetMB = 1024;
+
   juce::AudioProcessorValueTreeState state;
   juce::MidiKeyboardState midiState;
   juce::ThreadPool generalPurposeThreads{2};
@@ -52,6 +57,7 @@ private:
 
   void processInputQueue();
   void attachToState();
+  void updateGrainDataSettings();
   void updateSoundFromState();
   void valueChanged(juce::Value &) override;
   void valueTreePropertyChanged(juce::ValueTree &,
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <mutex>
+#include <unordered_map>
+
+// Recycles sample storage for grain waveforms. Requests are rounded up to
+// a size class, a quarter octave apart, and freed blocks wait on their
+// class's free list for the next waveform of a similar size rather than
+// going back to the heap. Idle storage is capped, beyond which blocks are
+// freed as usual.
+class SampleBufferPool : public juce::ReferenceCountedObject {
+public:
+  using Ptr = juce::ReferenceCountedObjectPtr<SampleBufferPool>;
+
+  static constexpr int minClassFloats = 1024;
+  static constexpr juce::int64 maxIdleBytes = 64 * 1024 * 1024;
+
+  struct Stats {
+    juce::int64 hits, misses;
+    // Every block we own, in use or idle
+    juce::int64 bytesResident, bytesIdle;
+  };
+
+  inline ~SampleBufferPool() override {
+    for (auto &item : freeLists) {
+      for (auto block : item.second) {
+        delete[] block;
+      }
+    }
+  }
+
+  // Rounds a size in floats up to its class
+  static inline int classFloats(int numFloats) noexcept {
+    if (numFloats <= minClassFloats) {
+      return minClassFloats;
+    }
+    auto octave = juce::nextPowerOfTwo(numFloats) / 2;
+    auto step = octave / 4;
+    return octave + (numFloats - octave + step - 1) / step * step;
+  }
+
+  // Storage for at least numFloats, with its actual size in capacity
+  inline float *allocate(int numFloats, int &capacity) {
+    capacity = classFloats(numFloats);
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      auto &list = freeLists[capacity];
+      if (!list.empty()) {
+        auto block = list.back();
+        list.pop_back();
+        bytesIdle -= bytesForFloats(capacity);
+        hits++;
+        return block;
+      }
+    }
+    misses++;
+    bytesResident += bytesForFloats(capacity);
+    return new float[size_t(capacity)];
+  }
+
+  inline void release(float *block, int capacity) {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (bytesIdle + bytesForFloats(capacity) <= maxIdleBytes) {
+        freeLists[capacity].push_back(block);
+        bytesIdle += bytesForFloats(capacity);
+        return;
+      }
+    }
+    bytesResident -= bytesForFloats(capacity);
+    delete[] block;
+  }
+
+  inline Stats getStats() const noexcept {
+    return Stats{.hits = hits,
+                 .misses = misses,
+                 .bytesResident = bytesResident,
+                 .bytesIdle = bytesIdle};
+  }
+
+private:
+  static inline juce::int64 bytesForFloats(int n) noexcept {
+    return juce::int64(n) * juce::int64(sizeof(float));
+  }
+
+  std::mutex mutex;
+  std::unordered_map<int, std::vector<float *>> freeLists;
+  std::atomic<juce::int64> hits{0}, misses{0};
+  std::atomic<juce::int64> bytesResident{0}, bytesIdle{0};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleBufferPool)
+};
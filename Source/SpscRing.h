@@ -0,0 +1,46 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Fixed capacity queue from one producer thread to one consumer thread.
+// Neither side locks, and nothing is allocated after construction. Items
+// are moved in and out, so a slot never holds on to a reference after it
+// has been consumed.
+template <typename T> class SpscRing {
+public:
+  inline SpscRing(int capacity)
+      : fifo(capacity + 1), slots(size_t(capacity + 1)) {}
+
+  inline int getFreeSpace() const noexcept { return fifo.getFreeSpace(); }
+  inline int getNumReady() const noexcept { return fifo.getNumReady(); }
+
+  // Producer only. When the ring is full, the item is left untouched.
+  template <typename U> inline bool push(U &&item) noexcept {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 < 1) {
+      return false;
+    }
+    slots[size_t(start1)] = std::forward<U>(item);
+    fifo.finishedWrite(1);
+    return true;
+  }
+
+  // Consumer only
+  inline bool pop(T &item) noexcept {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 < 1) {
+      return false;
+    }
+    item = std::move(slots[size_t(start1)]);
+    fifo.finishedRead(1);
+    return true;
+  }
+
+private:
+  juce::AbstractFifo fifo;
+  std::vector<T> slots;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpscRing)
+};
@@ -9,7 +9,7 @@ public:
   };
 
   struct WavePlayback {
-    GrainSequence::Point seq;
+    GrainSequence::Gains gains;
     juce::Range<int> samples;
   };
 
@@ -216,7 +216,7 @@ private:
     const auto &wave = *waveInfo.wave;
     map.bins.resize(width());
     for (const auto &playback : waveInfo.playing) {
-      const auto &gains = playback.seq.gains;
+      const auto &gains = playback.gains;
       auto totalGain = std::accumulate(gains.begin(), gains.end(), 0.f);
       auto samples = playback.samples + wave.key.window.range().getStart();
       auto columnStart = std::max<float>(
@@ -253,21 +253,41 @@ private:
 
 class WavePanel::RenderThread : public juce::Thread,
                                 public juce::ChangeBroadcaster,
-                                public GrainVoice::Listener {
+                                public GrainTelemetry::Listener {
 public:
   RenderThread(GrainSynth &synth)
       : Thread("wave-image"), synth(synth),
         collector(std::make_unique<ImageBuilder::State>()) {}
   ~RenderThread() override {}
 
-  void grainVoicePlaying(const GrainVoice &, const GrainSound &sound,
-                         GrainWaveform &wave, const GrainSequence::Point &seq,
-                         const juce::Range<int> &samples) override {
-    if (samples.getLength() > 0) {
-      std::lock_guard<std::mutex> guard(collectorMutex);
-      collector->ensureWidth(
-          sound.params.common.maxGrainWidthSamples(*sound.index));
-      collector->addPlayback(wave, *sound.index, {seq, samples});
+  void grainTelemetry(
+      const std::vector<GrainTelemetry::Event> &events) override {
+    // Playback events only identify their waveform, so we find it in the
+    // cache of the current sound. Anything already evicted is skipped.
+    auto sound = synth.latestSound();
+    if (sound == nullptr) {
+      return;
+    }
+    auto &index = *sound->index;
+    std::unordered_map<GrainWaveform::Key, GrainWaveform::Ptr,
+                       GrainWaveform::Hasher>
+        waves;
+    std::lock_guard<std::mutex> guard(collectorMutex);
+    for (auto &event : events) {
+      if (event.type != GrainTelemetry::Event::Type::playing ||
+          event.index != &index || event.samples.getLength() <= 0) {
+        continue;
+      }
+      auto found = waves.find(event.key);
+      if (found == waves.end()) {
+        found = waves.emplace(event.key, index.cache.peek(event.key)).first;
+      }
+      if (found->second != nullptr) {
+        collector->ensureWidth(
+            sound->params.common.maxGrainWidthSamples(index));
+        collector->addPlayback(*found->second, index,
+                               {event.gains, event.samples});
+      }
     }
   }
 
@@ -343,13 +363,13 @@ private:
 
 WavePanel::WavePanel(RvvProcessor &p)
     : processor(p), thread(std::make_unique<RenderThread>(processor.synth)) {
-  processor.synth.addListener(thread.get());
+  processor.synth.telemetry.addListener(thread.get());
   thread->startThread();
   thread->addChangeListener(this);
 }
 
 WavePanel::~WavePanel() {
-  processor.synth.removeListener(thread.get());
+  processor.synth.telemetry.removeListener(thread.get());
   thread->signalThreadShouldExit();
   thread->notify();
   thread->waitForThreadToExit(-1);
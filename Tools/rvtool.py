@@ -558,6 +558,18 @@ class FileForget:
             tqdm.tqdm.write(f"Add --forget to confirm forgetting paths: {len(paths)}")
 
 
+class RawSoundWriter:
+    def __init__(self, file, format):
+        self.file = file
+        self.format = format
+
+    def write(self, samples):
+        if self.format == "s16le":
+            self.file.write(samples.astype("<i2").tobytes())
+        else:
+            self.file.write((samples / 32768.0).astype("<f4").tobytes())
+
+
 class FilePacker:
     def arguments(parser):
         default_output = time.strftime("voice-%Y%m%d%H%M%S.rvv")
@@ -567,6 +579,7 @@ class FilePacker:
         default_width = 3.0
         default_mark = 20
         default_vprob = 0.99
+        default_format = "flac"
         Database.queryArguments(parser)
         parser.set_defaults(factory=FilePacker)
         parser.add_argument(
@@ -624,6 +637,13 @@ class FilePacker:
             default=default_mark,
             help=f"mark discontinuities with an N sample long noise [{default_mark}]",
         )
+        parser.add_argument(
+            "--format",
+            dest="format",
+            choices=("flac", "s16le", "f32le"),
+            default=default_format,
+            help=f"sound encoding, compressed or uncompressed PCM [{default_format}]",
+        )
 
     def __init__(self, args):
         self.args = args
@@ -778,6 +798,7 @@ class FilePacker:
             sampleRates,
             {
                 "sound_len": writerOffset,
+                "sound_format": self.args.format,
                 "max_grain_width": self.args.width,
                 "channels": self.channels,
                 "bin_x": list(map(int, self.bx)),
@@ -823,14 +844,20 @@ class FilePacker:
     def _writeArchiveFile(self):
         with zipfile.ZipFile(self.filename, "x", zipfile.ZIP_STORED) as z:
             with tempfile.TemporaryFile(dir=os.path.dirname(self.filename)) as tmp:
-                with soundfile.SoundFile(
-                    tmp,
-                    "w",
-                    48000,  # Arbitrary sample rate for FLAC header
-                    self.channels,
-                    "PCM_16",
-                    format="flac",
-                ) as sound:
+                if self.args.format == "flac":
+                    soundName = "sound.flac"
+                    with soundfile.SoundFile(
+                        tmp,
+                        "w",
+                        48000,  # Arbitrary sample rate for FLAC header
+                        self.channels,
+                        "PCM_16",
+                        format="flac",
+                    ) as sound:
+                        yygx, sampleRates, index = self._collectAudioData(sound)
+                else:
+                    soundName = "sound.pcm"
+                    sound = RawSoundWriter(tmp, self.args.format)
                     yygx, sampleRates, index = self._collectAudioData(sound)
 
                 tmp.seek(0, os.SEEK_END)
@@ -861,7 +888,7 @@ class FilePacker:
                     zipfile.ZIP_DEFLATED,
                     9,
                 )
-                with z.open(zipfile.ZipInfo("sound.flac"), "w", force_zip64=True) as f:
+                with z.open(zipfile.ZipInfo(soundName), "w", force_zip64=True) as f:
                     with tqdm.tqdm(
                         total=tmpLen, unit="byte", unit_scale=True
                     ) as progress: